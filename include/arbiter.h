@@ -6,24 +6,19 @@
 #include <vector>
 #include <string>
 #include <stdio.h>
-#include <queue>
-#include <list>
 #include "event.h"
+#include "interconnect.h"
+#include "arbitration.h"
+#include "timeseries.h"
+#include "tracelog.h"
 
 using std::vector;
 using std::string;
-using std::queue;
-using std::list;
 
 
 namespace SST {
 namespace xtsim {
 
-enum class ArbPolicy {
-	FIFO = 0, 
-	RR = 1
-};
-
 class XTSimArbiter : public SST::Component {
 public:
 
@@ -47,24 +42,33 @@ public:
     // { "parameter_name", "description", "default value or NULL if required" }
     SST_ELI_DOCUMENT_PARAMS(
         { "processorNum", "How many processor we have.", NULL},
-        { "arbPolicy",    "Which arbitration policy we use.", NULL}
+        { "arbPolicy",    "Arbitration policy one of FIFO(0), RR(1), WRR(2), AGE(3), TDM(4), PRIORITY(5)", "0"},
+        { "weights", "Per-core weights as [w0, w1, ...], the WRR burst, AGE age scale and TDM slots per frame", "[]"},
+        { "priorities", "Per-core priorities as [p0, p1, ...] for PRIORITY, higher wins", "[]"},
+        { "tdmSlot", "TDM slot length in ns", "100"},
+        { "agingThreshold", "ns of waiting that raise a PRIORITY request by one level, 0 disables aging", "1000"},
+        { "starvationThreshold", "Grant wait in ns counted as starvation", "10000"},
+        { "maxBusTransactions", "How many bus transactions may be granted at once.", "1"},
+        { "statFlushPeriod", "Period the local counters are flushed into the statistics, 0 flushes only at the end", "10us"},
+        { "roiMode", "roiMode of the generators, 2 holds the statistics back until the region of interest starts", "0"},
+        { "sampleInterval", "Period of the queue depth and grant time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        XTSIM_TRACE_PARAMS,
+        XTSIM_CHECKPOINT_PARAMS,
+        { "configId", "Id of the configuration this arbiter belongs to when sweeping several in one run", "0"}
     )
 
     // Document the ports that this component has
     // {"Port name", "Description", { "list of event types that the port can handle"} }
     SST_ELI_DOCUMENT_PORTS(
-        {"arbiterPort_0",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_1",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_2",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_3",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_4",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_5",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_6",  "Link to another component", { "xtsim.ArbEvent", ""} },
-        {"arbiterPort_7",  "Link to another component", { "xtsim.ArbEvent", ""} }
+        {"arbiterPort_%(processorNum)d",  "Link to the cache of each processor", { "xtsim.ArbEvent", ""} }
     )
     
-    // Optional since there is nothing to document - see statistics example for more info
-    SST_ELI_DOCUMENT_STATISTICS( )
+    SST_ELI_DOCUMENT_STATISTICS(
+        {"grants", "Grants per core, subId is the core", "events", 1},
+        {"grantWait", "ns waited for grants per core, subId is the core", "ns", 1},
+        {"starvedGrants", "Grants that waited longer than starvationThreshold, subId is the core", "events", 2}
+    )
 
     // Optional since there is nothing to document - see SubComponent examples for more info
     SST_ELI_DOCUMENT_SUBCOMPONENT_SLOTS( )
@@ -78,37 +82,48 @@ public:
     ~XTSimArbiter();
 
 private:
-	// fifo queue
-	queue<ArbEvent> fifoQueue;
-
-	// for round robin
-	size_t nextPid = 0;
-	list<ArbEvent> rrList;
-	list<ArbEvent>::iterator acIter;
+	// per-core request queues and the grant selection
+	Arbitration* arbitration;
 
+	// grant every request the arbitration lets through
 	void sendEvent();
 
 	// event handler
 	void handleEvent(SST::Event* ev);
 
-	// selector for Round-robin
-	void getNext();
+	// TDM slot boundary reached while requests wait for their slot
+	void handleWakeup(SST::Event* ev);
 
     // SST Output object, for printing, error messages, etc.
     SST::Output* out;
 
 	// number of processors
 	size_t processorNum;
-	vector<size_t> grantsNum;
 
-	// max request on-the-flight
-	size_t maxBusTransactions;
+	size_t configId;
+
+	void finish() override;
+	bool flushStats(Cycle_t cycle);
+	bool sampleTic(Cycle_t cycle);
+	void warmState(Serializer_t& ser);
+	// the first cache to enter the region of interest resets the grant statistics
+	void resetStats();
+	bool roiStarted = false;
+
+	// path prefix the arbitration position is written to at finish, empty writes none
+	string checkpointOut;
+
+	// queue depth, bus transactions granted and grants every sampleInterval
+	TimeSeries series;
+	TraceLog trace;
 
-	// ArbPolicy
-	ArbPolicy arbPolicy;
+	// the per-core grant counters of the arbitration, flushed in batches
+	StatCounterSet counters;
 
     // Links
 	vector<SST::Link*> links;
+	SST::Link* wakeupLink;
+	SimTime_t wakeupAt = 0;
 };
 
 }
@@ -0,0 +1,131 @@
+#ifndef _XTSIM_ARBITRATION_H
+#define _XTSIM_ARBITRATION_H
+
+#include <vector>
+#include <deque>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <sst/core/sst_types.h>
+#include <sst/core/params.h>
+#include <sst/core/output.h>
+#include "statcounter.h"
+#include "checkpoint.h"
+
+namespace SST {
+namespace xtsim {
+
+enum class ArbPolicy {
+	FIFO = 0, 
+	RR = 1,
+	WRR = 2, // round robin, a core keeps the grant for up to weight requests in a row
+	AGE = 3, // oldest waiting request first, its age scaled by the core's weight
+	TDM = 4, // fixed time slots, a core owns weight slots per frame and only the owner is granted
+	PRIORITY = 5 // strict priority, waiting requests gain one level per agingThreshold
+};
+
+struct ArbConfig_t {
+	ArbPolicy policy;
+	size_t maxGrants; // requests that may hold the resource at once
+	std::vector<size_t> weights; // per core, WRR burst, AGE scale and TDM slots
+	std::vector<size_t> priorities; // per core, higher wins
+	SimTime_t tdmSlot; // ns
+	SimTime_t agingThreshold; // ns
+	SimTime_t starvationThreshold; // ns
+};
+
+// Grant wait statistics of one core, in ns
+struct ArbWaitStats_t {
+	StatCounter grants;
+	StatCounter waitSum;
+	SimTime_t waitMax = 0;
+	StatCounter starved; // grants that waited longer than starvationThreshold
+};
+
+/*
+ * Grants a shared resource to agents that each queue any number of requests.
+ *
+ * Every agent has its own queue of request arrival times and a bit in a
+ * pending mask. Round robin finds the next requester with a find-first-set
+ * over the mask words starting after the last winner, FIFO pops a ring of
+ * agent ids in arrival order, so a grant never scans the request queues.
+ * AGE and PRIORITY compare the heads of the pending agents only.
+ * Up to maxGrants requests may hold the resource at once.
+ */
+class Arbitration {
+public:
+    Arbitration(size_t nagents, const ArbConfig_t& config);
+
+    // Read arbPolicy, maxBusTransactions and the QoS parameters shared by the arbiter and the bus
+    static ArbConfig_t readConfig(SST::Params& params, SST::Output* out, const std::string& name, size_t nagents);
+
+    // Queue one request of agent arriving at now
+    void request(size_t agent, SimTime_t now);
+
+    // One granted request of agent finished, false when agent holds no grant (a release without a grant)
+    bool release(size_t agent);
+
+    // Grant the next request, returns its agent or -1 when nothing can be granted now
+    int next(SimTime_t now);
+
+    // When next() returned -1 only because no pending agent owns the current TDM slot,
+    // the start of the next slot, otherwise 0
+    SimTime_t retryAt(SimTime_t now);
+
+    // The owning component binds the counters to its per-core statistics
+    ArbWaitStats_t& stats(size_t agent) { return waitStats[agent]; }
+
+    // Agents whose oldest request has been waiting longer than starvationThreshold
+    size_t starving(SimTime_t now);
+
+    // Restart the longest waits with the region of interest, the counters reset with their StatCounterSet
+    void resetStats() { for (ArbWaitStats_t& stats : waitStats) stats.waitMax = 0; }
+
+    // Remember the agents still starving when the simulation ends
+    void finish(SimTime_t now) { starvingAtExit = starving(now); }
+
+    // Print the [arbiter-stat] grant and wait statistics
+    void report(size_t configId);
+
+    ArbPolicy getPolicy() { return config.policy; }
+
+    // Requests waiting for a grant and grants not yet released
+    size_t queued() const { return npending; }
+    size_t granted() const { return active; }
+
+    // Round robin position and WRR burst, the warm state a checkpoint keeps of an idle arbitration
+    void checkpoint(Serializer_t& ser) { ser & rrNext; ser & wrrCredits; }
+
+    // Step over the state checkpoint() wrote, for a run that arbitrates elsewhere
+    static void skipCheckpoint(Serializer_t& ser) { size_t unused = 0; ser & unused; ser & unused; }
+
+private:
+    int findPending(size_t from);
+    void setPending(size_t agent, bool on);
+    int pickWrr();
+    int pickAge(SimTime_t now);
+    int pickTdm(SimTime_t now);
+    int pickPriority(SimTime_t now);
+
+    size_t nagents;
+    ArbConfig_t config;
+    size_t active = 0; // granted and not yet released
+    std::vector<size_t> held; // grants not yet released per agent
+
+    std::vector<std::deque<SimTime_t>> queues; // arrival times of queued requests per agent
+    std::vector<uint64_t> pendingMask; // bit per agent with a non-empty queue
+    size_t npending = 0; // requests queued over all agents
+    size_t rrNext = 0; // round robin starts searching here
+    std::deque<uint32_t> arrivalOrder; // agent of every queued request, for FIFO
+
+    size_t wrrCredits = 0; // grants the current WRR winner may still take in a row
+    std::vector<uint32_t> tdmTable; // owner of each slot of a TDM frame
+
+    std::vector<ArbWaitStats_t> waitStats;
+    size_t starvingAtExit = 0;
+};
+
+}
+}
+
+#endif
@@ -34,7 +34,14 @@
 #include <sst/core/component.h>
 #include <sst/core/link.h>
 #include "event.h"
+#include "checkpoint.h"
+#include "missclassifier.h"
+#include "hotspot.h"
+#include "statcounter.h"
+#include "timeseries.h"
+#include "tracelog.h"
 #include <queue>
+#include <unordered_map>
 
 
 namespace SST {
@@ -63,6 +70,12 @@ struct OutRequest_t {
     std::vector<CacheEvent> alias;
 };
 
+// A processor access crossing line boundaries, answered when its last line completes
+struct SplitAccess_t {
+    size_t parts; // line requests still outstanding
+    size_t addr; // address of the whole access
+};
+
 typedef struct CacheLine_t {
     bool valid;
     size_t address;
@@ -100,7 +113,22 @@ public:
         { "associativity", "Cache associativity", "4"},
         { "replacementPolicy", "Replacement policy one of RR(0), LRU(1), MRU(2)", "1"},
         { "cacheId", "Id of this cache", "0"},
-        { "protocol", "Cache coherency protocol one of MSI(0), MESI(1)", "0"}
+        { "protocol", "Cache coherency protocol one of MSI(0), MESI(1)", "0"},
+        { "configId", "Id of the configuration this cache belongs to when sweeping several in one run", "0"},
+        { "classifyMisses", "Classify misses as compulsory/capacity/conflict/true sharing/false sharing (0 or 1)", "0"},
+        { "wordSize", "Word granularity in bytes used to tell true from false sharing", "4"},
+        { "missClassTopN", "Number of offending lines and PCs reported by the miss classifier", "10"},
+        { "profileHotspots", "Attribute misses, upgrades and invalidations to PCs, pages and lines (0 or 1)", "0"},
+        { "hotspotTopN", "Number of PCs, pages and lines reported per hotspot ranking", "10"},
+        { "pageSize", "Page size in bytes the hotspot profiler groups addresses by", "4096"},
+        { "writebackDirty", "Write dirty victims back to memory through the bus (0 or 1)", "0"},
+        { "integratedArbiter", "The bus arbitrates, send requests straight to it and leave arbiterPort unconnected (0 or 1)", "0"},
+        { "statFlushPeriod", "Period the local counters are flushed into the statistics, 0 flushes only at the end", "10us"},
+        { "roiMode", "roiMode of the generators, 2 holds the statistics back until the region of interest starts", "0"},
+        { "sampleInterval", "Period of the hit/miss and outstanding request time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        XTSIM_TRACE_PARAMS,
+        XTSIM_CHECKPOINT_PARAMS
     )
 
     // Document the ports that this component has
@@ -116,7 +144,18 @@ public:
         {"hits", "Statistic that records unsigned 32-bit values", "unitless", 1},
         {"misses", "Statistic that records unsigned 32-bit values", "unitless", 1},
         {"evictions", "Statistic that records unsigned 32-bit values", "unitless", 1},
-        {"invalidations", "Statistic that records unsigned 32-bit values", "unitless", 1}
+        {"invalidations", "Statistic that records unsigned 32-bit values", "unitless", 1},
+        {"compulsoryMisses", "Misses on the first reference to a line", "unitless", 2},
+        {"capacityMisses", "Misses that also miss in a fully associative cache of the same size", "unitless", 2},
+        {"conflictMisses", "Misses that hit in a fully associative cache of the same size", "unitless", 2},
+        {"trueSharingMisses", "Misses on a line invalidated by a remote write to an accessed word", "unitless", 2},
+        {"falseSharingMisses", "Misses on a line invalidated by remote writes to other words only", "unitless", 2},
+        {"mergedMisses", "Misses merged into an outstanding request for the same line", "unitless", 2},
+        {"writebacks", "Dirty victims written back to memory", "unitless", 1},
+        {"upgradeConversions", "BUS_UPGRs sent as BUS_RDX because the line was lost before the grant", "unitless", 2},
+        {"upgradeRetries", "BUS_UPGRs requested again as BUS_RDX because the line was lost before bus order", "unitless", 2},
+        {"splitAccesses", "Processor accesses crossing a line boundary, split into one request per line", "unitless", 1},
+        {"splitLineAccesses", "Line requests the split accesses added on top of one per access", "unitless", 2}
      )
 
     // Optional since there is nothing to document - see SubComponent examples for more info
@@ -134,10 +173,13 @@ private:
     // Event handler, called when an event is received on our link
     void handleProcessorOp(SST::Event *ev);
     void handleProcessorEvent(CacheEvent *ev);
+    void splitAccess(CacheEvent *ev, size_t first, size_t last);
+    void respond(CacheEvent *ev);
     void handleBusOp(SST::Event *ev);
-    void handleBusEvent(CacheEvent *ev);
+    void handleBusEvent(const SnoopMsg_t& snoop);
     void handleArbOp(SST::Event *ev);
-    void handleOutRequest(CacheEvent *event);
+    bool handleOutRequest(CacheEvent *event);
+    bool completeUpgrade(CacheEvent *event);
     void handleOutRequestMesi(CacheEvent *event);
     void handleOutRequestMsi(CacheEvent *event);
 
@@ -170,14 +212,25 @@ private:
 
     // Helper functions
     CacheLine_t* lookupCache(size_t addr);
+    size_t getSetIndex(size_t addr);
+    void classifyMiss(CacheEvent* event);
     void parseParams(Params& params);
     size_t logFunc(size_t num);
     CacheLine_t& evictLine(CacheEvent* event);
+    void writeback(CacheLine_t& line);
+    void upgradeLine(CacheEvent* event);
     void acquireBus(CacheEvent* event);
     void releaseBus(CacheEvent* event);
+    void sendToBus();
+    bool flushStats(Cycle_t cycle);
+    bool sampleTic(Cycle_t cycle);
+    void warmState(Serializer_t& ser);
+    void resetStats();
+    void finish() override;
 
     // Parameters
     size_t cacheId;
+    size_t configId;
     size_t blockSize;
     size_t cacheSize;
     size_t associativity;
@@ -195,6 +248,31 @@ private:
     // Replacement policy data structures
     std::vector<size_t> rrCounter;
 
+    // Miss classification, nullptr unless classifyMisses is set
+    MissClassifier* classifier;
+    size_t missClassTopN;
+    StatCounter mergedMisses;
+
+    // Per PC/page/line attribution, nullptr unless profileHotspots is set
+    HotspotProfiler* profiler;
+    size_t hotspotTopN;
+
+    // Dirty victims sent to memory when writebackDirty is set
+    bool writebackDirty;
+
+    // The bus arbitrates requests itself, no XTSimArbiter round trips
+    bool integratedArbiter;
+    StatCounter nwritebacks;
+
+    // BUS_UPGRs turned into BUS_RDX because a remote write invalidated the line first
+    StatCounter upgradeConversions;
+    StatCounter upgradeRetries;
+
+    // Accesses crossing a line boundary by transactionId, and how many there were
+    std::unordered_map<size_t, SplitAccess_t> splitAccesses;
+    StatCounter nsplits;
+    StatCounter nsplitLines;
+
     // SST Output object, for printing, error messages, etc.
     SST::Output* out;
 
@@ -203,11 +281,22 @@ private:
     SST::Link* buslink;
     SST::Link* arblink;
 
-    // Statistics
-    Statistic<uint64_t>* nhits;
-    Statistic<uint64_t>* nmisses;
-    Statistic<uint64_t>* nevictions;
-    Statistic<uint64_t>* ninvalidations;
+    // Statistics, counted locally and flushed into their SST statistics in batches
+    StatCounterSet counters;
+    StatCounter nhits;
+    StatCounter nmisses;
+    StatCounter nevictions;
+    StatCounter ninvalidations;
+    StatCounter nmissClass[5];
+
+    // hits, misses and outstanding misses every sampleInterval
+    TimeSeries series;
+
+    // binary transaction log, see tracelog.h
+    TraceLog trace;
+
+    // path prefix the warm state is written to at finish, empty writes none
+    std::string checkpointOut;
 };
 
 } // namespace simpleElementExample
@@ -0,0 +1,86 @@
+#ifndef _XTSIM_CHECKPOINT_H
+#define _XTSIM_CHECKPOINT_H
+
+#include <sst/core/output.h>
+#include <sst/core/serialization/serializer.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Parameters of every component with warm state, for SST_ELI_DOCUMENT_PARAMS
+#define XTSIM_CHECKPOINT_PARAMS \
+        { "checkpointOut", "Path prefix the warm state is written to when the run ends, <prefix><component name>.ckpt, empty writes none", ""}, \
+        { "checkpointIn", "Path prefix of a checkpoint to start from instead of the cold state, empty starts cold", ""}
+
+namespace SST {
+namespace xtsim {
+
+typedef SST::Core::Serialization::serializer Serializer_t;
+
+/*
+ * Warm state of one component, written when a warmup run ends and read back
+ * while the runs that branch from it are constructed.
+ *
+ * A component serializes its state with one function that is called in all
+ * three serializer modes, so sizing, packing and unpacking cannot disagree.
+ * The function starts with the geometry the state depends on, through
+ * expect(), so a restore into a configuration it does not fit stops instead
+ * of silently mixing the two. Statistics are not part of the state, a
+ * restored run counts from zero.
+ *
+ * The file is <prefix><component name>.ckpt, a small header (magic, version,
+ * length) followed by the packed state.
+ */
+class Checkpoint {
+public:
+    template <class F>
+    static void save(SST::Output* out, const std::string& prefix, const std::string& name, F state) {
+        Serializer_t ser;
+        ser.start_sizing();
+        state(ser);
+        std::vector<char> buffer(ser.size());
+        ser.start_packing(buffer.data(), buffer.size());
+        state(ser);
+        write(out, prefix + name + ".ckpt", buffer);
+    }
+
+    template <class F>
+    static void restore(SST::Output* out, const std::string& prefix, const std::string& name, F state) {
+        std::string path = prefix + name + ".ckpt";
+        std::vector<char> buffer = read(out, path);
+        Serializer_t ser;
+        ser.start_unpacking(buffer.data(), buffer.size());
+        state(ser);
+        if (ser.size() != buffer.size())
+            out->fatal(CALL_INFO, -1, "Error! %s holds %zu bytes but %s restored %zu\n", path.c_str(), buffer.size(), name.c_str(), ser.size());
+    }
+
+    // A parameter the state depends on, restoring it into a different value stops the simulation
+    static void expect(Serializer_t& ser, SST::Output* out, const std::string& name, const char* what, size_t value);
+
+    // An unordered map as its sorted keys, each followed by the value serialized by valueState
+    template <class K, class V, class F>
+    static void map(Serializer_t& ser, std::unordered_map<K, V>& map, F valueState) {
+        std::vector<K> keys;
+        if (ser.mode() != Serializer_t::UNPACK) {
+            for (auto& entry : map)
+                keys.push_back(entry.first);
+            std::sort(keys.begin(), keys.end());
+        } else {
+            map.clear();
+        }
+        ser & keys;
+        for (K& key : keys)
+            valueState(ser, map[key]);
+    }
+
+private:
+    static void write(SST::Output* out, const std::string& path, const std::vector<char>& buffer);
+    static std::vector<char> read(SST::Output* out, const std::string& path);
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _XTSIM_COHERENCE_H
+#define _XTSIM_COHERENCE_H
+
+#include <bitset>
+#include <unordered_map>
+#include <string>
+#include <sst/core/output.h>
+#include "event.h"
+#include "checkpoint.h"
+
+namespace SST {
+namespace xtsim {
+
+// Largest processorNum the response bitmasks can represent
+const size_t MAX_BUS_AGENTS = 256;
+typedef std::bitset<MAX_BUS_AGENTS> AgentMask_t;
+
+// What the ordered bus transactions allow the caches to hold of one line
+struct LineGrant_t {
+	AgentMask_t sharers; // caches that may hold a copy, a superset since clean evictions are silent
+	int owner = -1; // cache that may hold it E or M
+};
+
+/*
+ * Single-writer/multiple-reader checker for the snooping bus.
+ *
+ * The bus reports every transaction when it starts snooping and when it
+ * retires, in bus order. From that order the checker knows which caches may
+ * still hold each line and which one may hold it writable. Every snoop
+ * response is then a sample of the real cache state: a cache that answers
+ * with a copy it was never given, or that survived an invalidation, or a
+ * modified copy outside the owner, stops the simulation.
+ */
+class CoherenceChecker {
+public:
+    CoherenceChecker(SST::Output* out, const std::string& name) : out(out), name(name) { }
+
+    // A transaction of pid on line starts snooping
+    void start(size_t line, pid_t pid, EVENT_TYPE type);
+
+    // pid answered a snoop of requester on line with rsp
+    void snoopResponse(size_t line, pid_t pid, pid_t requester, EVENT_TYPE rsp);
+
+    // A transaction retired, its reply rsp reached pid
+    void complete(size_t line, pid_t pid, EVENT_TYPE type, EVENT_TYPE rsp);
+
+    // pid wrote its dirty copy of line back and no longer holds it
+    void writeback(size_t line, pid_t pid);
+
+    size_t checks() { return nchecks; }
+
+    // Sharers and owner of every line, a run restored into warm caches checks against them
+    void checkpoint(Serializer_t& ser);
+
+private:
+    SST::Output* out;
+    std::string name;
+    std::unordered_map<size_t, LineGrant_t> lines;
+    size_t nchecks = 0;
+};
+
+}
+}
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef _XTSim_EVENT_H_
 #define _XTSim_EVENT_H_
 #include <sst/core/event.h>
+#include <memory>
 
 namespace SST {
 namespace xtsim {
@@ -14,12 +15,22 @@ enum class EVENT_TYPE{
     FLUSH = 5, // supply a block to a requesting cache
     SHARED = 6, // Another cache has it in shared state
     NOT_SHARED = 7,  // This cache line is not present
-    EMPTY = 8 // Indicates an empty response
+    EMPTY = 8, // Indicates an empty response
+    BUS_WB = 9, // posted write back of a dirty victim to memory, not snooped
+    ROI_BEGIN = 10 // the region of interest starts, shared components reset their statistics
+};
+
+enum class DATA_SRC {
+    HIT = 0, // served by the local cache
+    CACHE = 1, // served on the bus by another cache (or an upgrade)
+    MEMORY = 2, // served by memory
+    LLC = 3 // served by the shared last level cache in front of memory
 };
 
 enum class ARB_EVENT_TYPE {
 	AC = 0, // acquire exclusive access to a bus
-	RL = 1  // release the exclusive access to the bus
+	RL = 1, // release the exclusive access to the bus
+	RS = 2  // the region of interest starts, reset the grant statistics
 };
 
 class CacheEvent : public SST::Event
@@ -37,6 +48,13 @@ public:
 	size_t transactionId;
     size_t cacheLineIdx;
     EVENT_TYPE rsp;
+    size_t pc = 0; // instruction address that issued the access
+    uint32_t size = 0; // bytes accessed, 0 when the trace does not record sizes
+    DATA_SRC src = DATA_SRC::HIT; // where the response came from
+    uint64_t arbWait = 0; // ns spent waiting for the arbiter grant
+    uint64_t busTime = 0; // ns from the grant to the bus response
+    uint32_t busTag = 0; // bus transaction slot, echoed back in snoop responses
+    bool roiBegin = false; // first access of the region of interest, the cache resets its statistics
 
     // Events must provide a serialization function that serializes
     // all data members of the event
@@ -48,12 +66,80 @@ public:
 		ser & transactionId;
         ser & cacheLineIdx;
         ser & rsp;
+        ser & pc;
+        ser & size;
+        ser & src;
+        ser & arbWait;
+        ser & busTime;
+        ser & busTag;
+        ser & roiBegin;
     }
 
     // Register this event as serializable
     ImplementSerializable(SST::xtsim::CacheEvent);
 };
 
+// The part of a bus request the snooping caches need, shared read-only by all of them
+struct SnoopMsg_t {
+	EVENT_TYPE event_type;
+    size_t addr;
+    pid_t pid;
+	size_t transactionId;
+    size_t cacheLineIdx;
+    uint32_t busTag;
+    size_t pc; // instruction of the requester, for the hotspot profiler
+    uint32_t size; // bytes the requester accesses, for the words the miss classifier marks
+};
+
+// A snoop delivered to one cache, every receiver points at the same message
+class SnoopEvent : public SST::Event
+{
+public:
+	SnoopEvent() : SST::Event() { }
+    SnoopEvent(std::shared_ptr<const SnoopMsg_t> msg) : SST::Event(), msg(msg) { }
+
+    std::shared_ptr<const SnoopMsg_t> msg;
+
+    // Across ranks the message is copied, each rank rebuilds its own shared copy
+    void serialize_order(SST::Core::Serialization::serializer &ser)  override {
+        Event::serialize_order(ser);
+        SnoopMsg_t m = msg ? *msg : SnoopMsg_t();
+		ser & m.event_type;
+        ser & m.addr;
+		ser & m.pid;
+		ser & m.transactionId;
+        ser & m.cacheLineIdx;
+        ser & m.busTag;
+        ser & m.pc;
+        ser & m.size;
+        if (ser.mode() == SST::Core::Serialization::serializer::UNPACK)
+            msg = std::make_shared<const SnoopMsg_t>(m);
+    }
+
+    ImplementSerializable(SST::xtsim::SnoopEvent);
+};
+
+// Compact snoop response token, rsp is SHARED, FLUSH or EMPTY
+class SnoopRespEvent : public SST::Event
+{
+public:
+	SnoopRespEvent() : SST::Event() { }
+    SnoopRespEvent(EVENT_TYPE rsp, pid_t pid, uint32_t busTag) : SST::Event(), rsp(rsp), pid(pid), busTag(busTag) { }
+
+	EVENT_TYPE rsp;
+    pid_t pid;
+    uint32_t busTag;
+
+    void serialize_order(SST::Core::Serialization::serializer &ser)  override {
+        Event::serialize_order(ser);
+		ser & rsp;
+		ser & pid;
+        ser & busTag;
+    }
+
+    ImplementSerializable(SST::xtsim::SnoopRespEvent);
+};
+
 class ArbEvent : public SST::Event {
 public:
     // Constructor
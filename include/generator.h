@@ -4,6 +4,9 @@
 #include <sst/core/component.h>
 #include <sst/core/link.h>
 #include "event.h"
+#include "checkpoint.h"
+#include "histogram.h"
+#include "timeseries.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -40,13 +43,24 @@ public:
     // { "parameter_name", "description", "default value or NULL if required" }
     SST_ELI_DOCUMENT_PARAMS(
         { "generatorID", "How many events this component should send.", NULL},
-        { "traceFilePath",    "Payload size for each event, in bytes.", NULL}
+        { "traceFilePath",    "Payload size for each event, in bytes.", NULL},
+        { "maxOutstandingReq", "Maximum number of requests in flight per port.", NULL},
+        { "numShadows", "Number of shadow configurations fed the same trace through shadowPort_N.", "0"},
+        { "sampleInterval", "Period of the completed/outstanding time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        { "reportProgress", "Also print a [progress] line with the throughput of every sample (1) or not (0)", "0"},
+        { "watchdogInterval", "Flag a port whose requests are outstanding but none completed for this long, 0 disables it", "100us"},
+        { "watchdogFatal", "Stop the simulation when the watchdog fires (1) or only warn (0)", "0"},
+        { "roiMode", "Region of interest markers of the trace: ignore them (0), simulate only the ROI (1), or simulate the accesses before it as warmup and count from its begin (2)", "0"},
+        { "warmupAccesses", "End the run after this many accesses of the trace, e.g. to checkpoint the warm state there, 0 runs the whole trace", "0"},
+        XTSIM_CHECKPOINT_PARAMS
     )
 
     // Document the ports that this component has
     // {"Port name", "Description", { "list of event types that the port can handle"} }
     SST_ELI_DOCUMENT_PORTS(
-        {"processorPort",  "Link to another component", { "xtsim.CacheEvent", ""} }
+        {"processorPort",  "Link to another component", { "xtsim.CacheEvent", ""} },
+        {"shadowPort_%(numShadows)d",  "Link to the cache of a shadow configuration", { "xtsim.CacheEvent", ""} }
     )
     
     // Optional since there is nothing to document - see statistics example for more info
@@ -78,15 +92,30 @@ private:
 	// Read from trace file
 	void readFromTrace();
 
-	void sendEvent();
+	// Cut eventList to the region of interest of the trace, see roiMode
+	void applyRoi(size_t roiMode);
 
-	// event handler
-	void handleEvent(SST::Event* ev);
+	void sendEvent(size_t port);
+
+	// event handler, port 0 is processorPort and port k is shadowPort_(k-1)
+	void handleEvent(SST::Event* ev, size_t port);
 	
 	size_t getNextTransactionID(){
 		return generatorID * MAX_EVENT_NUM + eventList.size();
 	}
 
+	// Record the end-to-end latency of a completed request
+	void recordLatency(size_t port, CacheEvent* ev);
+
+	// time series sample and forward progress check, both stop once every port drained the trace
+	bool sampleTic(SST::Cycle_t cycle);
+	bool watchdogTic(SST::Cycle_t cycle);
+	void reportStall(size_t port, SimTime_t now);
+
+	// trace position of every port, a restored run continues the trace where the checkpoint left it
+	void warmState(Serializer_t& ser);
+	void finish() override;
+
     // Parameters
     // vector< curTrace;
     // int eventSize;
@@ -103,17 +132,57 @@ private:
 
 	vector<CacheEvent> eventList;
 
+	// region of interest, indices into eventList of the accesses after the "#roi begin" and "#roi end" lines
+	static const size_t NO_ROI = ~0ull;
+	size_t traceRoiBegin = NO_ROI;
+	size_t traceRoiEnd = NO_ROI;
+	size_t roiStart = 0; // accesses before it only warm the caches up, their latencies are not recorded
+
 	size_t maxOutstandingReq;
 
-	// event offset
-	size_t offset = 0;
-    size_t receiveCount = 0;
+	// number of shadow configurations sharing this trace
+	size_t numShadows;
+	size_t portsDone = 0;
+
+	// per-port event offset, every configuration walks the shared eventList at its own pace
+	vector<size_t> offset;
+    vector<size_t> receiveCount;
+
+	// per-port send time in ns of every event in eventList, REQ_COMPLETED once it returned
+	vector<vector<uint64_t>> sendTime;
+	static const uint64_t REQ_COMPLETED = ~0ull;
+
+	// time series of completed and outstanding requests per port
+	TimeSeries series;
+	bool reportProgress;
+	size_t lastSampled = 0;
+	double lastSampleWall = 0.0;
+	SimTime_t lastSampleNs = 0;
+
+	// forward progress watchdog
+	bool watchdogFatal;
+	SimTime_t lastCheckNs = 0;
+	vector<size_t> watchdogCount; // receiveCount at the previous check
+	vector<bool> stalled; // reported once per stall, cleared when a request completes again
+	vector<SimTime_t> stalledSince;
+
+	// per-port latency histograms, indexed by [read/write][DATA_SRC]
+	struct LatencyStats_t {
+		LatencyHistogram total[2][4];
+		LatencyHistogram cachePhase;
+		LatencyHistogram arbiterPhase;
+		LatencyHistogram busPhase;
+	};
+	vector<LatencyStats_t> latency;
 
     // Links
-    SST::Link* link;
+    vector<SST::Link*> links;
 
 	bool started = false;
 
+	// path prefix the trace positions are written to at finish, empty writes none
+	string checkpointOut;
+
 	/* statistics */
 	Statistic<uint64_t>* stat_inst_cnt;
 };
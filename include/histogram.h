@@ -0,0 +1,46 @@
+#ifndef _XTSIM_HISTOGRAM_H
+#define _XTSIM_HISTOGRAM_H
+
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace SST {
+namespace xtsim {
+
+/*
+ * Log-bucketed latency histogram.
+ *
+ * Values below 2^SUB_BITS get a bucket each, above that every power of two is
+ * split into 2^SUB_BITS linear sub-buckets, so percentiles are reported with a
+ * relative error below 1 / 2^SUB_BITS whatever the latency range.
+ */
+class LatencyHistogram {
+public:
+    void add(uint64_t value);
+
+    uint64_t getCount() const { return count; }
+    double getMean() const { return count ? (double) sum / count : 0.0; }
+    uint64_t getMax() const { return max; }
+
+    // Upper bound of the bucket holding the p-quantile, p in [0, 1]
+    uint64_t percentile(double p) const;
+
+    void print(const char* prefix, const char* label) const;
+
+private:
+    static const size_t SUB_BITS = 4;
+
+    static size_t bucketOf(uint64_t value);
+    static uint64_t bucketHigh(size_t bucket);
+
+    std::vector<uint64_t> buckets;
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef _XTSIM_HOTSPOT_H
+#define _XTSIM_HOTSPOT_H
+
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+
+namespace SST {
+namespace xtsim {
+
+// What one PC, page or line is charged with
+struct HotspotCount_t {
+    uint64_t misses = 0;
+    uint64_t upgrades = 0; // BUS_UPGRs of writes to shared copies
+    uint64_t invalidations = 0; // a PC: remote copies its writes invalidated, a page or line: copies invalidated here
+};
+
+/*
+ * Open-addressing hash table from a PC, page or line to its counts.
+ *
+ * Linear probing over a power-of-two array of 32-byte entries, so a lookup
+ * is one multiplicative hash and usually a single cache line. Keys are never
+ * removed and the table doubles past 3/4 full.
+ */
+class HotspotTable {
+public:
+    HotspotTable();
+
+    HotspotCount_t& operator[](uint64_t key);
+
+    // The topN keys with the largest counts of field, in decreasing order
+    std::vector<std::pair<uint64_t, HotspotCount_t>> top(uint64_t HotspotCount_t::*field, size_t topN) const;
+
+    size_t size() const { return used; }
+
+private:
+    static const uint64_t EMPTY_KEY = ~0ull; // never a PC, page or line number
+
+    struct Entry_t {
+        uint64_t key;
+        HotspotCount_t count;
+    };
+
+    size_t slotOf(uint64_t key) const { return (key * 0x9e3779b97f4a7c15ull) >> shift; }
+    void grow();
+
+    std::vector<Entry_t> entries;
+    size_t used = 0;
+    size_t shift; // 64 - log2(entries.size())
+};
+
+/*
+ * Attributes the misses, upgrades and invalidations of one cache to the
+ * instruction that caused them and to the page and line they touched.
+ *
+ * Misses and upgrades are charged to the local access. An invalidation a
+ * snoop brings in is charged to the invalidated page and line here and to
+ * the remote PC whose write caused it, which the snoop carries along, so
+ * the PC report names the stores that cost other caches their copies.
+ */
+class HotspotProfiler {
+public:
+    HotspotProfiler(size_t blockSize, size_t pageSize) : blockSize(blockSize), pageSize(pageSize) { }
+
+    void miss(size_t addr, size_t pc);
+    void upgrade(size_t addr, size_t pc);
+
+    // A remote write of remotePc invalidated our copy of addr
+    void invalidation(size_t addr, size_t remotePc);
+
+    void report(size_t configId, size_t cacheId, size_t topN);
+
+    // Forget everything charged so far
+    void reset();
+
+private:
+    void reportTop(const char* prefix, const char* what, const HotspotTable& table, uint64_t HotspotCount_t::*field,
+        const char* fieldName, uint64_t total, size_t scale, size_t topN);
+
+    size_t blockSize;
+    size_t pageSize;
+
+    HotspotTable pcs;
+    HotspotTable pages;
+    HotspotTable lines;
+
+    uint64_t totalMisses = 0;
+    uint64_t totalUpgrades = 0;
+    uint64_t totalInvalidations = 0;
+};
+
+}
+}
+
+#endif
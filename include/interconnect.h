@@ -4,21 +4,79 @@
 #include <sst/core/component.h>
 #include <sst/core/link.h>
 #include <vector>
+#include <deque>
+#include <bitset>
 #include <unordered_map>
 #include <string>
 #include <stdio.h>
 // #include <condition_variable>
 // #include <mutex>
 #include "event.h"
+#include "arbitration.h"
+#include "coherence.h"
+#include "statcounter.h"
+#include "timeseries.h"
+#include "tracelog.h"
 
 using std::vector;
+using std::deque;
 using std::string;
-using std::unordered_map;
 
 
 namespace SST {
 namespace xtsim {
 
+// One in-flight bus transaction, indexed by the busTag carried on its snoops
+struct BusSlot_t {
+	CacheEvent req; // the original request
+	size_t nresp; // snoop responses folded in so far
+	AgentMask_t sharedMask; // responders that held a copy
+	AgentMask_t dirtyMask; // responders that held the copy modified
+	bool responded; // the requester already got its reply
+	bool delivered; // the reply left the bus, after the data phase on the split bus
+	bool memPending; // waiting for memory to supply the line
+	SimTime_t arrival; // bus cycle the request arrived, for queueing statistics
+	std::shared_ptr<const SnoopMsg_t> snoop; // built once, shared by every snooping cache
+};
+
+enum class BusModel_t {
+	ATOMIC = 0, // zero occupancy, only the arbiter serializes
+	SPLIT = 1 // pipelined split-transaction bus with address/snoop and data phases
+};
+
+enum class Interleave_t {
+	LINE = 0, // consecutive cache lines go to consecutive channels
+	PAGE = 1, // consecutive pages go to consecutive channels
+	XOR = 2 // line bits hashed with page bits, spreads strided accesses
+};
+
+enum class NumaPlacement_t {
+	INTERLEAVE = 0, // pages round-robin across nodes
+	FIRST_TOUCH = 1 // a page lives on the node of the processor that first misses on it
+};
+
+// Transactions on one cache line, only reads sharing one memory fill run together
+struct LineQueue_t {
+	size_t active = 0; // started and not yet retired
+	bool readFill = false; // a BUS_RD is waiting on memory, later reads may join its fill
+	deque<uint32_t> waiting; // tags of conflicting transactions in arrival order
+};
+
+// Load of one memory channel
+struct MemChannelStats_t {
+	StatCounter reads;
+	StatCounter writebacks;
+	StatCounter remote; // accesses from processors of another NUMA node
+};
+
+// Occupancy and queueing statistics of one bus phase, in bus cycles
+struct BusPhaseStats_t {
+	StatCounter transfers;
+	StatCounter busyCycles;
+	StatCounter waitCycles;
+	SimTime_t maxWait = 0;
+};
+
 class XTSimBus : public SST::Component {
 public:
 
@@ -40,27 +98,70 @@ public:
 
     // Document the parameters that this component accepts
     // { "parameter_name", "description", "default value or NULL if required" }
-    // SST_ELI_DOCUMENT_PARAMS(
-    //     { "generatorID", "How many events this component should send.", NULL},
-    //     { "traceFilePath",    "Payload size for each event, in bytes.", NULL}
-    // )
+    SST_ELI_DOCUMENT_PARAMS(
+        { "processorNum", "How many processor we have.", NULL},
+        { "memoryAccessTime", "Memory access time in ns used for the memory time estimate", "100"},
+        { "busSlots", "Initial size of the transaction slot table, it grows if more are in flight", "16"},
+        { "busModel", "Bus timing model one of ATOMIC(0), SPLIT(1) transaction", "0"},
+        { "busClock", "Bus clock for the split-transaction model", "1GHz"},
+        { "busWidth", "Data bus width in bytes for the split-transaction model", "16"},
+        { "blockSize", "Cache block size in bytes moved by one data phase", "64"},
+        { "pipelineDepth", "Transactions allowed in the address/snoop phase at once", "4"},
+        { "memChannels", "Number of memory components, ports are memPort_<n> when more than one", "1"},
+        { "interleave", "Channel interleaving one of LINE(0), PAGE(1), XOR(2)", "0"},
+        { "pageSize", "Page size in bytes for page interleaving and NUMA placement", "4096"},
+        { "numaNodes", "NUMA nodes, 0 disables NUMA. Channels and processors are split evenly across nodes", "0"},
+        { "numaPlacement", "Page placement one of INTERLEAVE(0), FIRST_TOUCH(1)", "0"},
+        { "remoteLatency", "Extra bus cycles for an access to the memory of another NUMA node", "50"},
+        { "integratedArbiter", "Arbitrate inside the bus, caches send requests directly and never talk to an XTSimArbiter (0 or 1)", "0"},
+        { "arbPolicy", "Integrated arbitration policy, as for XTSimArbiter", "0"},
+        { "maxBusTransactions", "Integrated arbitration: transactions granted at once", "1"},
+        { "weights", "Integrated arbitration: per-core weights, as for XTSimArbiter", "[]"},
+        { "priorities", "Integrated arbitration: per-core priorities, as for XTSimArbiter", "[]"},
+        { "tdmSlot", "Integrated arbitration: TDM slot length in ns", "100"},
+        { "agingThreshold", "Integrated arbitration: ns of waiting that raise a PRIORITY request by one level", "1000"},
+        { "starvationThreshold", "Integrated arbitration: grant wait in ns counted as starvation", "10000"},
+        { "statFlushPeriod", "Period the local counters are flushed into the statistics, 0 flushes only at the end", "10us"},
+        { "roiMode", "roiMode of the generators, 2 holds the statistics back until the region of interest starts", "0"},
+        { "sampleInterval", "Period of the in-flight transaction and traffic time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        XTSIM_TRACE_PARAMS,
+        XTSIM_CHECKPOINT_PARAMS,
+        { "checkCoherence", "Check single-writer/multiple-reader on every snoop response, fatal on a violation (0 or 1)", "0"},
+        { "configId", "Id of the configuration this bus belongs to when sweeping several in one run", "0"}
+    )
 
     // Document the ports that this component has
     // {"Port name", "Description", { "list of event types that the port can handle"} }
     SST_ELI_DOCUMENT_PORTS(
-        {"busPort_0",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_1",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_2",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_3",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_4",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_5",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_6",  "Link to another component", { "xtsim.CacheEvent", ""} },
-        {"busPort_7",  "Link to another component", { "xtsim.CacheEvent", ""} },
-		{"memPort",  "Link to Memory", { "xtsim.CacheEvent", ""} }
+        {"busPort_%(processorNum)d",  "Link to the cache of each processor", { "xtsim.CacheEvent", ""} },
+		{"memPort",  "Link to Memory when memChannels is 1", { "xtsim.CacheEvent", ""} },
+		{"memPort_%(memChannels)d",  "Link to each memory channel when memChannels is more than 1", { "xtsim.CacheEvent", ""} }
     )
     
-    // Optional since there is nothing to document - see statistics example for more info
-    SST_ELI_DOCUMENT_STATISTICS( )
+    SST_ELI_DOCUMENT_STATISTICS(
+        {"totalTraffic", "Events sent and received by the bus", "events", 1},
+        {"reqTraffic", "Requests from the caches", "events", 1},
+        {"respTraffic", "Snoop responses from the caches", "events", 1},
+        {"memoryTraffic", "Reads and write backs exchanged with memory", "events", 1},
+        {"writebackTraffic", "Posted write backs of dirty victims", "events", 1},
+        {"earlyReplies", "Replies sent before every snoop response arrived", "events", 2},
+        {"coalescedFills", "Reads that joined another read's memory fill", "events", 2},
+        {"lineConflicts", "Transactions that waited for another one on the same line", "events", 2},
+        {"conflictCycles", "Bus cycles transactions waited on line conflicts", "cycles", 2},
+        {"addrTransfers", "Split bus address phases", "events", 2},
+        {"addrBusyCycles", "Split bus cycles the address bus was busy", "cycles", 2},
+        {"addrWaitCycles", "Split bus cycles requests waited for the address bus", "cycles", 2},
+        {"dataTransfers", "Split bus data phases", "events", 2},
+        {"dataBusyCycles", "Split bus cycles the data bus was busy", "cycles", 2},
+        {"dataWaitCycles", "Split bus cycles blocks waited for the data bus", "cycles", 2},
+        {"channelReads", "Reads sent to each memory channel, subId is the channel", "events", 3},
+        {"channelWritebacks", "Write backs sent to each memory channel, subId is the channel", "events", 3},
+        {"channelRemote", "Accesses from another NUMA node per memory channel, subId is the channel", "events", 3},
+        {"grants", "Integrated arbitration: grants per core, subId is the core", "events", 3},
+        {"grantWait", "Integrated arbitration: ns waited for grants per core, subId is the core", "ns", 3},
+        {"starvedGrants", "Integrated arbitration: grants that waited past starvationThreshold, subId is the core", "events", 3}
+    )
 
     // Optional since there is nothing to document - see SubComponent examples for more info
     SST_ELI_DOCUMENT_SUBCOMPONENT_SLOTS( )
@@ -84,28 +185,132 @@ private:
 
 	void handleMemEvent(SST::Event* ev);
 
-	// broadcast
-	void broadcast(size_t pidToFilter, CacheEvent* ev);
+	// pass a posted write back of a dirty victim on to memory
+	void writeback(CacheEvent* ev);
+
+	// route a read or write back to its channel, delay is in bus cycles
+	void sendToMemory(CacheEvent* ev, SimTime_t delay);
+	size_t channelOf(size_t addr);
+	size_t homeNode(size_t addr, pid_t pid);
+
+	// a new request from a cache, allocate a slot and snoop the other caches once its line is free
+	void startTransaction(CacheEvent* ev);
+	void launch(uint32_t tag);
+	bool joinFill(uint32_t tag);
+	void coalesceWaiting(size_t line);
+	// free the slot once snoops, memory and reply are all done, then start the next transaction on the line
+	void tryRetire(uint32_t tag);
+	void releaseLine(size_t line);
+
+	// the first cache to enter the region of interest resets the statistics here and behind every channel
+	void beginRoi(CacheEvent* ev);
+
+	// integrated arbitration, start every request that wins a grant
+	void grantRequests();
+	void handleArbWakeup(SST::Event* ev);
+	// the requester got its reply, which releases its grant
+	void complete(pid_t pid);
+
+	// fold one snoop response into its slot
+	void handleSnoopResponse(pid_t pid, EVENT_TYPE rsp, uint32_t tag);
+
+	// reply to the requester of a slot
+	void respond(BusSlot_t& slot, EVENT_TYPE rsp, DATA_SRC src);
+
+	uint32_t allocSlot();
+	void freeSlot(uint32_t tag);
+
+	// split-transaction phases
+	void issueAddrPhase(uint32_t tag);
+	void handleAddrPhase(SST::Event* ev);
+	void snoopDone();
+	void transferData(CacheEvent* ev);
+	void handleDataPhase(SST::Event* ev);
+	void finish() override;
+	bool flushStats(Cycle_t cycle);
+	bool sampleTic(Cycle_t cycle);
+	void warmState(Serializer_t& ser);
+
+	// send the snoop of a slot to every cache but the requester
+	void broadcast(uint32_t tag);
 
     // SST Output object, for printing, error messages, etc.
     SST::Output* out;
 
     // Links
     vector<SST::Link*> links;
-	SST::Link* memLink;
-	unordered_map<size_t, vector<CacheEvent>> transactionsMap;
+	vector<SST::Link*> memLinks;
+	SST::Link* addrLink;
+	SST::Link* dataLink;
+	SST::Link* arbWakeupLink;
 
-    std::vector<CacheEvent*> eventsToBcast;
+	// transaction slot table and the tags of its unused slots
+	vector<BusSlot_t> slots;
+	vector<uint32_t> freeSlots;
 
 	size_t processorNum;
 	size_t memoryAccessTime;
+	size_t configId;
+
+	// integrated arbitration, nullptr when an XTSimArbiter does it
+	Arbitration* arbitration;
+	vector<deque<CacheEvent>> portQueues; // requests of each cache waiting for a grant
+	SimTime_t arbWakeupAt = 0;
+
+	// memory channels and NUMA nodes
+	size_t memChannels;
+	Interleave_t interleave;
+	size_t blockSize;
+	size_t pageSize;
+	size_t numaNodes;
+	NumaPlacement_t numaPlacement;
+	SimTime_t remoteLatency;
+	std::unordered_map<size_t, size_t> pageHome; // first-touch page to node
+	vector<MemChannelStats_t> channelStats;
+
+	// lines being fetched from memory and the reads that joined each fill
+	std::unordered_map<size_t, vector<uint32_t>> pendingFills;
+
+	// per-line ordering of concurrent transactions
+	std::unordered_map<size_t, LineQueue_t> busyLines;
+
+	// nullptr unless checkCoherence is set
+	CoherenceChecker* checker;
+
+	// path prefix the page placement, checker and arbitration state are written to at finish, empty writes none
+	string checkpointOut;
+
+	// split-transaction bus model
+	BusModel_t busModel;
+	TimeConverter* busTc;
+	size_t pipelineDepth;
+	SimTime_t dataCycles; // cycles one cache block occupies the data bus
+	SimTime_t addrFree = 0; // first cycle the address bus is free
+	SimTime_t dataFree = 0; // first cycle the data bus is free
+	size_t snoopInFlight = 0; // transactions in the address/snoop phase
+	deque<uint32_t> addrQueue; // requests waiting for a free pipeline stage
+	SimTime_t elapsedCycles = 0;
+	bool roiStarted = false;
+	SimTime_t roiCycle = 0; // bus cycle the region of interest started, utilization only covers what follows
 
-	/* statistics */
-	size_t totalTraffic; // num of send & recv happened on the bus
-	size_t reqTraffic;
-	size_t respTraffic;
-	size_t memoryTraffic;
+	/* statistics, counted locally and flushed into their SST statistics in batches */
+	StatCounterSet counters;
+	StatCounter totalTraffic; // num of send & recv happened on the bus
+	StatCounter reqTraffic;
+	StatCounter respTraffic;
+	StatCounter memoryTraffic;
+	StatCounter writebackTraffic;
+	StatCounter earlyReplies; // replies sent before every snoop response arrived
+	StatCounter coalescedFills; // reads that joined another read's memory fill without snooping
+	StatCounter lineConflicts; // transactions that waited for another one on the same line
+	size_t maxLineQueue = 0;
+	StatCounter conflictCycles; // bus cycles spent waiting on line conflicts
+	BusPhaseStats_t addrStats;
+	BusPhaseStats_t dataStats;
 
+	// in-flight transactions, line conflicts and traffic every sampleInterval
+	TimeSeries series;
+	TraceLog trace;
 };
 } // namespace xtsim
 } // namespace SST
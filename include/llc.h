@@ -0,0 +1,205 @@
+#ifndef _XTSIM_LLC_H
+#define _XTSIM_LLC_H
+
+#include <sst/core/component.h>
+#include <sst/core/link.h>
+#include "event.h"
+#include "checkpoint.h"
+#include "statcounter.h"
+#include "timeseries.h"
+#include <vector>
+#include <string>
+
+
+using std::vector;
+using std::string;
+
+namespace SST {
+namespace xtsim {
+
+enum class PartitionMode_t {
+	SHARED = 0, // one LRU over all ways, cores evict each other freely
+	WAY_MASK = 1, // static per-core way masks, a core only allocates into its own ways
+	UTILITY = 2 // way quotas recomputed from the utility monitors every repartitionPeriod
+};
+
+typedef struct LlcLine_t {
+	bool valid = false;
+	bool dirty = false;
+	size_t address = 0;
+	size_t owner = 0; // core whose miss or write back allocated the line
+	size_t timestamp = 0;
+} LlcLine_t;
+
+// Per-core counters of the shared cache
+struct LlcCoreStats_t {
+	StatCounter hits;
+	StatCounter misses;
+	StatCounter writebacks; // dirty lines the core's private cache wrote back here
+	size_t occupancy = 0; // valid lines the core owns now
+	size_t maxOccupancy = 0;
+	uint64_t occupancyArea = 0; // lines * ns, for the mean occupancy
+	SimTime_t lastChange = 0;
+};
+
+/*
+ * Utility monitor of one core, the UMON of utility-based cache partitioning.
+ *
+ * An auxiliary tag directory keeps the tags the core would hold in a sample of
+ * the sets if it had the whole cache to itself, in LRU order. A hit at stack
+ * position p would be a hit with p + 1 or more ways, so hits[p] summed over
+ * the first n positions is the hits the core gets from n ways.
+ */
+class UtilityMonitor {
+public:
+	void init(size_t sampledSets, size_t associativity);
+
+	// A demand access of the core to line tag in sampled set idx
+	void access(size_t idx, size_t tag);
+
+	// Hits the core would gain going from ways to ways + extra
+	uint64_t gain(size_t ways, size_t extra) const;
+
+	// Age the counters so the next period weighs the recent behaviour more
+	void decay();
+
+	size_t sampledSets() const { return tags.size(); }
+	void checkpoint(Serializer_t& ser) { ser & tags; ser & hits; }
+
+private:
+	vector<vector<size_t>> tags; // per sampled set, most recently used first
+	vector<uint64_t> hits; // per stack position
+};
+
+class XTSimLLC : public SST::Component {
+public:
+
+/*
+ *  SST Registration macros register Components with the SST Core and
+ *  document their parameters, ports, etc.
+ *  SST_ELI_REGISTER_COMPONENT is required, the documentation macros
+ *  are only required if relevant
+ */
+    // REGISTER THIS COMPONENT INTO THE ELEMENT LIBRARY
+    SST_ELI_REGISTER_COMPONENT(
+        XTSimLLC,                       // Component class
+        "xtsim",         // Component library (for Python/library lookup)
+        "XTSimLLC",                     // Component name (for Python/library lookup)
+        SST_ELI_ELEMENT_VERSION(1,0,0), // Version of the component (not related to SST version)
+        "Shared Last Level Cache slice with way partitioning",        // Description
+        COMPONENT_CATEGORY_UNCATEGORIZED    // Category
+    )
+
+    // Document the parameters that this component accepts
+    // { "parameter_name", "description", "default value or NULL if required" }
+    SST_ELI_DOCUMENT_PARAMS(
+        { "processorNum", "Number of cores sharing the cache", NULL},
+        { "llcClock", "Clock of the tag lookup, hitLatency is in its cycles", "1GHz"},
+        { "cacheSize", "Size of this slice in bytes", "1048576"},
+        { "associativity", "Ways per set", "16"},
+        { "blockSize", "Cache block size in bytes", "64"},
+        { "hitLatency", "Cycles from a request to its hit response or to the miss going to memory", "10"},
+        { "partitionMode", "Way partitioning one of SHARED(0), WAY_MASK(1), UTILITY(2)", "0"},
+        { "wayMasks", "WAY_MASK only, one bit mask of allowed ways per core, all ways when empty", "[]"},
+        { "umonSampleSets", "UTILITY only, every umonSampleSets-th set feeds the utility monitors", "32"},
+        { "repartitionPeriod", "UTILITY only, period the way quotas are recomputed", "10us"},
+        { "channels", "Channels the bus interleaves over, one slice sits in front of each", "1"},
+        { "interleaveSize", "Bytes mapped to one channel before moving to the next (the bus blockSize or pageSize)", "64"},
+        { "statFlushPeriod", "Period the local counters are flushed into the statistics, 0 flushes only at the end", "10us"},
+        { "roiMode", "roiMode of the generators, 2 holds the statistics back until the region of interest starts", "0"},
+        { "sampleInterval", "Period of the per-core occupancy time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        XTSIM_CHECKPOINT_PARAMS,
+        { "configId", "Id of the configuration this cache belongs to when sweeping several in one run", "0"}
+    )
+
+
+    // Document the ports that this component has
+    // {"Port name", "Description", { "list of event types that the port can handle"} }
+    SST_ELI_DOCUMENT_PORTS(
+        {"busPort",  "Link to the memory port of the bus", { "xtsim.CacheEvent", ""} },
+        {"memPort",  "Link to the memory channel", { "xtsim.CacheEvent", ""} }
+    )
+
+    SST_ELI_DOCUMENT_STATISTICS(
+        {"llcHits", "Reads served by the cache, per core", "events", 1},
+        {"llcMisses", "Reads sent on to memory, per core", "events", 1},
+        {"llcWritebacks", "Write backs absorbed by the cache, per core", "events", 2},
+        {"memWritebacks", "Dirty victims written to memory", "events", 1},
+        {"repartitions", "Times the UTILITY quotas changed", "events", 2}
+    )
+
+    // Optional since there is nothing to document - see SubComponent examples for more info
+    SST_ELI_DOCUMENT_SUBCOMPONENT_SLOTS( )
+
+// Class members
+
+    // Constructor. Components receive a unique ID and the set of parameters that were assigned in the Python input.
+    XTSimLLC(SST::ComponentId_t id, SST::Params& params);
+
+    // Destructor
+    ~XTSimLLC();
+
+private:
+
+	// event handlers
+	void handleBusEvent(SST::Event* ev);
+	void handleMemEvent(SST::Event* ev);
+
+	size_t getSetIndex(size_t addr);
+	LlcLine_t* lookup(size_t addr);
+	LlcLine_t& allocate(size_t addr, size_t core);
+	LlcLine_t& pickVictim(vector<LlcLine_t>& cacheSet, size_t core);
+	void setOwner(LlcLine_t& line, size_t core);
+	void touchOccupancy(size_t core);
+	// the bus forwards the start of the region of interest, the occupancy figures cover what follows
+	void resetStats();
+	bool repartition(Cycle_t cycle);
+	void warmState(Serializer_t& ser);
+	void finish() override;
+	bool flushStats(Cycle_t cycle);
+	bool sampleTic(Cycle_t cycle);
+
+
+    // SST Output object, for printing, error messages, etc.
+    SST::Output* out;
+
+    // // Links
+    SST::Link* busLink;
+    SST::Link* memLink;
+	TimeConverter* llcTc;
+
+	// geometry, one component models the slice in front of one channel
+	size_t processorNum;
+	size_t cacheSize;
+	size_t associativity;
+	size_t blockSize;
+	size_t nsets;
+	size_t channels;
+	size_t interleaveSize;
+	SimTime_t hitLatency;
+	size_t configId;
+	string checkpointOut; // path prefix the lines and quotas are written to at finish, empty writes none
+	size_t timestamp = 0;
+	vector<vector<LlcLine_t>> cacheLines;
+
+	// partitioning
+	PartitionMode_t mode;
+	vector<size_t> wayMasks; // WAY_MASK, bit i allows way i
+	vector<size_t> quota; // UTILITY, ways each core may fill in a set
+	vector<UtilityMonitor> monitors;
+	size_t umonSampleSets;
+
+	/* statistics, counted locally and flushed into their SST statistics in batches */
+	StatCounterSet counters;
+	TimeSeries series;
+	vector<LlcCoreStats_t> coreStats;
+	StatCounter memWritebacks;
+	StatCounter repartitions;
+	SimTime_t elapsedNs = 0;
+	SimTime_t roiNs = 0;
+
+};
+}
+}
+#endif
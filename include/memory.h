@@ -4,15 +4,49 @@
 #include <sst/core/component.h>
 #include <sst/core/link.h>
 #include "event.h"
+#include "checkpoint.h"
+#include "statcounter.h"
+#include "timeseries.h"
+#include "tracelog.h"
 #include <vector>
+#include <deque>
 #include <string>
 #include <fstream>
 #include <iostream>
 
 
+using std::vector;
+using std::deque;
+using std::string;
+
 namespace SST {
 namespace xtsim {
 
+enum class PagePolicy_t {
+	OPEN = 0, // keep the row open until another row of the bank is needed
+	CLOSED = 1 // precharge right after every access
+};
+
+// One queued DRAM access, reads keep the cache request to answer it
+struct DramRequest_t {
+	CacheEvent* ev; // nullptr for posted writes
+	size_t addr;
+	size_t transactionId;
+	bool write;
+	size_t line;
+	size_t rank;
+	size_t bank;
+	size_t row;
+	SimTime_t arrival; // memory cycle the request arrived
+};
+
+// Row buffer state of one bank
+struct DramBank_t {
+	bool open = false;
+	size_t row = 0;
+	SimTime_t readyAt = 0; // first cycle the bank accepts the next command
+};
+
 class XTSimMemory : public SST::Component {
 public:
 
@@ -28,10 +62,38 @@ public:
         "xtsim",         // Component library (for Python/library lookup)
         "XTSimMemory",                     // Component name (for Python/library lookup)
         SST_ELI_ELEMENT_VERSION(1,0,0), // Version of the component (not related to SST version)
-        "Simple Memory Component",        // Description
+        "DRAM Memory Controller Component",        // Description
         COMPONENT_CATEGORY_UNCATEGORIZED    // Category
     )
 
+    // Document the parameters that this component accepts
+    // { "parameter_name", "description", "default value or NULL if required" }
+    SST_ELI_DOCUMENT_PARAMS(
+        { "memClock", "DRAM command clock, all timings are in its cycles", "1GHz"},
+        { "ranks", "Ranks on the channel", "1"},
+        { "banks", "Banks per rank", "8"},
+        { "rowSize", "Row buffer size in bytes", "2048"},
+        { "blockSize", "Cache block size in bytes moved by one burst", "64"},
+        { "pagePolicy", "Row buffer policy one of OPEN(0), CLOSED(1)", "0"},
+        { "tRCD", "Activate to column command delay", "14"},
+        { "tCAS", "Column command to data delay", "14"},
+        { "tRP", "Precharge delay", "14"},
+        { "tBurst", "Cycles a block occupies the data bus", "4"},
+        { "readQueueSize", "Read requests the scheduler can pick from, later ones wait in arrival order", "32"},
+        { "writeQueueSize", "Write requests the scheduler can pick from, later ones wait in arrival order", "32"},
+        { "writeHighWatermark", "Write queue occupancy that starts draining writes", "24"},
+        { "writeLowWatermark", "Write queue occupancy that stops draining writes", "8"},
+        { "channels", "Channels the bus interleaves over, used to drop the channel bits before row/bank mapping", "1"},
+        { "interleaveSize", "Bytes mapped to one channel before moving to the next (the bus blockSize or pageSize)", "64"},
+        { "statFlushPeriod", "Period the local counters are flushed into the statistics, 0 flushes only at the end", "10us"},
+        { "roiMode", "roiMode of the generators, 2 holds the statistics back until the region of interest starts", "0"},
+        { "sampleInterval", "Period of the queue depth and request time series, 0 disables it", "0"},
+        { "timeSeriesPrefix", "Path prefix of the time series file, <prefix><component name>.csv", ""},
+        XTSIM_TRACE_PARAMS,
+        XTSIM_CHECKPOINT_PARAMS,
+        { "configId", "Id of the configuration this memory belongs to when sweeping several in one run", "0"}
+    )
+
 
     // Document the ports that this component has
     // {"Port name", "Description", { "list of event types that the port can handle"} }
@@ -39,8 +101,19 @@ public:
         {"port",  "Link to another component", { "xtsim.CacheEvent", ""} }
     )
     
-    // Optional since there is nothing to document - see statistics example for more info
-    SST_ELI_DOCUMENT_STATISTICS( )
+    SST_ELI_DOCUMENT_STATISTICS(
+        {"reads", "Reads received, including the ones forwarded from queued writes", "events", 1},
+        {"writes", "Write backs received", "events", 1},
+        {"forwardedReads", "Reads served from a queued write to the same line", "events", 2},
+        {"rowHits", "Accesses to the open row", "events", 1},
+        {"rowMisses", "Accesses to a precharged bank", "events", 1},
+        {"rowConflicts", "Accesses that closed another open row", "events", 1},
+        {"writeDrains", "Times the write queue reached writeHighWatermark", "events", 2},
+        {"readLatency", "Memory cycles from arrival to the last data beat, summed over DRAM reads", "cycles", 2},
+        {"readOccupancy", "Read queue length summed over active cycles", "requests", 3},
+        {"writeOccupancy", "Write queue length summed over active cycles", "requests", 3},
+        {"busyCycles", "Memory cycles the data bus was busy", "cycles", 2}
+    )
 
     // Optional since there is nothing to document - see SubComponent examples for more info
     SST_ELI_DOCUMENT_SUBCOMPONENT_SLOTS( )
@@ -58,12 +131,77 @@ private:
 	// event handler
 	void handleEvent(SST::Event* ev);
 
+	// scheduler, runs only while requests are queued
+	bool clockTic(SST::Cycle_t cycle);
+	bool forwardFromWrites(size_t line);
+	int pickRequest(deque<DramRequest_t>& queue, SimTime_t now);
+	void issue(DramRequest_t& req, SimTime_t now);
+	void fillQueue(deque<DramRequest_t>& queue, deque<DramRequest_t>& overflow, size_t size);
+	void finish() override;
+	bool flushStats(Cycle_t cycle);
+	bool sampleTic(Cycle_t cycle);
+	void warmState(Serializer_t& ser);
+	// the bus forwards the start of the region of interest, the queue and bandwidth figures cover what follows
+	void resetStats();
+
 
     // SST Output object, for printing, error messages, etc.
     SST::Output* out;
 
     // // Links
     SST::Link* link;
+	TimeConverter* memTc;
+	Clock::HandlerBase* clockHandler;
+	bool clockOn = false;
+
+	// geometry and timing, one component models one channel
+	size_t ranks;
+	size_t banks;
+	size_t blockSize;
+	size_t linesPerRow;
+	size_t channels;
+	size_t interleaveSize;
+	PagePolicy_t pagePolicy;
+	SimTime_t tRCD;
+	SimTime_t tCAS;
+	SimTime_t tRP;
+	SimTime_t tBurst;
+	size_t readQueueSize;
+	size_t writeQueueSize;
+	size_t writeHighWatermark;
+	size_t writeLowWatermark;
+	size_t configId;
+	string checkpointOut; // path prefix the open rows are written to at finish, empty writes none
+
+	vector<DramBank_t> bankState; // rank * banks + bank
+	deque<DramRequest_t> readQueue;
+	deque<DramRequest_t> writeQueue;
+	deque<DramRequest_t> readOverflow; // arrived while the read queue was full
+	deque<DramRequest_t> writeOverflow;
+	bool drainingWrites = false;
+	SimTime_t dataFree = 0; // first cycle the data bus is free
+
+	/* statistics, counted locally and flushed into their SST statistics in batches */
+	StatCounterSet counters;
+	TimeSeries series;
+	TraceLog trace;
+	StatCounter reads;
+	StatCounter writes;
+	StatCounter rowHits;
+	StatCounter rowMisses; // bank precharged, activate only
+	StatCounter rowConflicts; // another row open, precharge and activate
+	StatCounter writeDrains;
+	StatCounter forwardedReads; // served from a queued write to the same line
+	StatCounter readLatency; // arrival to last data beat, in memory cycles
+	StatCounter readOccupancy; // sum of the read queue length over active cycles
+	StatCounter writeOccupancy;
+	size_t maxReadQueue = 0;
+	size_t maxWriteQueue = 0;
+	StatCounter busyCycles; // data bus busy
+	SimTime_t elapsedCycles = 0;
+	SimTime_t elapsedNs = 0;
+	SimTime_t roiCycle = 0;
+	SimTime_t roiNs = 0;
 
 };
 }
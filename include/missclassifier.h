@@ -0,0 +1,85 @@
+#ifndef _XTSIM_MISSCLASSIFIER_H
+#define _XTSIM_MISSCLASSIFIER_H
+
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <stdio.h>
+#include <stdint.h>
+#include "checkpoint.h"
+
+namespace SST {
+namespace xtsim {
+
+enum class MissClass_t {
+    COMPULSORY = 0, // first reference to the line
+    CAPACITY = 1, // would also miss in a fully associative LRU cache of the same size
+    CONFLICT = 2, // hits in the fully associative shadow, lost to set mapping
+    TRUE_SHARING = 3, // line was invalidated by a remote write to a word we access
+    FALSE_SHARING = 4 // line was invalidated by remote writes to other words only
+};
+
+/*
+ * Classifies the misses of one cache into the 3C + coherence classes.
+ *
+ * Capacity and conflict misses are told apart with a shadow fully associative
+ * LRU structure holding as many lines as the real cache. Coherence misses are
+ * split into true and false sharing with a per-line mask of the words written
+ * remotely since the line was invalidated here. An access of size bytes covers
+ * all the words it touches, a size of 0 (a trace without sizes) one word.
+ */
+class MissClassifier {
+public:
+    MissClassifier(size_t nlines, size_t blockSize, size_t wordSize);
+
+    // Classify a miss of the access at addr, must be called before access()
+    MissClass_t classify(size_t addr, size_t size, size_t pc);
+
+    // Record a reference to addr in the shadow structure, on hits and misses
+    void access(size_t addr);
+
+    // A remote write (BusRdX/BusUpgr) of size bytes at addr was snooped,
+    // hadLine tells whether it invalidated our copy
+    void invalidate(size_t addr, size_t size, bool hadLine);
+
+    void report(size_t configId, size_t cacheId, size_t topN);
+
+    // Lines seen, the shadow LRU order and the pending invalidations, not the reported counts
+    void checkpoint(Serializer_t& ser);
+
+    // Forget the offending lines and PCs charged so far, the shadow state stays warm
+    void resetReport() { lineSharing.clear(); pcSharing.clear(); }
+
+private:
+    struct SharingCount_t {
+        size_t trueSharing = 0;
+        size_t falseSharing = 0;
+    };
+
+    uint64_t wordMask(size_t addr, size_t size);
+    void reportTop(const char* prefix, const char* what, std::unordered_map<size_t, SharingCount_t>& counts,
+        size_t topN, size_t scale);
+
+    size_t nlines;
+    size_t blockSize;
+    size_t wordSize;
+
+    std::unordered_set<size_t> seen;
+
+    // Shadow fully associative LRU, most recently used at the front
+    std::list<size_t> lruList;
+    std::unordered_map<size_t, std::list<size_t>::iterator> lruMap;
+
+    // Lines invalidated by a remote write and the words written remotely since
+    std::unordered_map<size_t, uint64_t> invalidated;
+
+    // Offending lines and PCs of coherence misses
+    std::unordered_map<size_t, SharingCount_t> lineSharing;
+    std::unordered_map<size_t, SharingCount_t> pcSharing;
+};
+
+}
+}
+
+#endif
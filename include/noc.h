@@ -0,0 +1,225 @@
+#ifndef _XTSIM_NOC_H
+#define _XTSIM_NOC_H
+
+#include <sst/core/component.h>
+#include <sst/core/link.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <stdio.h>
+#include <unordered_map>
+#include "event.h"
+#include "interconnect.h"
+#include "coherence.h"
+
+using std::vector;
+using std::deque;
+using std::string;
+
+
+namespace SST {
+namespace xtsim {
+
+enum class NocTopology_t {
+	RING = 0, // bidirectional ring, shortest direction, dateline VC classes
+	MESH = 1 // 2D mesh with dimension-order XY routing
+};
+
+enum class NocPacketType_t {
+	SNOOP = 0, // requester to every other cache
+	SNOOP_RSP = 1, // snooping cache back to the requester
+	MEM_REQ = 2, // requester to the memory node
+	MEM_RSP = 3 // memory node back to the requester
+};
+
+// A coherence message travelling through the routers
+struct NocPacket_t {
+	CacheEvent payload;
+	NocPacketType_t type;
+	size_t dst; // destination router
+	size_t cur; // router currently buffering the packet
+	size_t flits;
+	int inLink; // link the packet arrived on, -1 while at its source
+	int inVc;
+	bool crossedDateline;
+	size_t hops;
+	SimTime_t injectTime;
+};
+
+// Occupancy and flow control state of one directed router-to-router link
+struct NocLink_t {
+	size_t from;
+	size_t to;
+	bool dateline; // the ring wrap-around link
+	SimTime_t freeAt = 0;
+	vector<size_t> credits; // free flit slots per VC in the downstream buffer
+	deque<uint32_t> waiting; // packets blocked on credits, in arrival order
+	size_t packets = 0;
+	size_t flits = 0;
+	SimTime_t busyCycles = 0;
+	size_t blocked = 0;
+};
+
+// Self-link event moving a packet to its next router pipeline stage
+class NocHopEvent : public SST::Event {
+public:
+	NocHopEvent() : SST::Event() { }
+	NocHopEvent(uint32_t packet) : SST::Event(), packet(packet) { }
+
+	uint32_t packet;
+
+    void serialize_order(SST::Core::Serialization::serializer &ser)  override {
+        Event::serialize_order(ser);
+		ser & packet;
+    }
+
+    ImplementSerializable(SST::xtsim::NocHopEvent);
+};
+
+class XTSimNoC : public SST::Component {
+public:
+
+/*
+ *  SST Registration macros register Components with the SST Core and
+ *  document their parameters, ports, etc.
+ *  SST_ELI_REGISTER_COMPONENT is required, the documentation macros
+ *  are only required if relevant
+ */
+    // REGISTER THIS COMPONENT INTO THE ELEMENT LIBRARY
+    SST_ELI_REGISTER_COMPONENT(
+        XTSimNoC,                       // Component class
+        "xtsim",         // Component library (for Python/library lookup)
+        "XTSimNoC",                     // Component name (for Python/library lookup)
+        SST_ELI_ELEMENT_VERSION(1,0,0), // Version of the component (not related to SST version)
+        "Ring and 2D mesh Network-on-Chip Interconnect Component",        // Description
+        COMPONENT_CATEGORY_NETWORK    // Category
+    )
+
+    // Document the parameters that this component accepts
+    // { "parameter_name", "description", "default value or NULL if required" }
+    SST_ELI_DOCUMENT_PARAMS(
+        { "processorNum", "How many processor we have.", NULL},
+        { "topology", "Network topology one of RING(0), MESH(1)", "0"},
+        { "meshX", "Routers per mesh row, 0 picks a square-ish mesh", "0"},
+        { "meshY", "Mesh rows, 0 picks enough rows for processorNum", "0"},
+        { "memoryNode", "Router the memory controller is attached to", "0"},
+        { "nocClock", "Router clock", "1GHz"},
+        { "routerLatency", "Router pipeline latency in cycles", "2"},
+        { "linkLatency", "Link traversal latency in cycles", "1"},
+        { "linkBandwidth", "Flits a link carries per cycle", "1"},
+        { "flitSize", "Flit size in bytes", "16"},
+        { "blockSize", "Cache block size in bytes carried by data packets", "64"},
+        { "numVCs", "Virtual channels per link, the ring needs at least 2", "2"},
+        { "vcBufferDepth", "Buffer depth in flits of each virtual channel", "8"},
+        { "hotspotTopN", "Number of most utilized links reported", "5"},
+        { "checkCoherence", "Check single-writer/multiple-reader on every snoop response, fatal on a violation (0 or 1)", "0"},
+        { "configId", "Id of the configuration this network belongs to when sweeping several in one run", "0"}
+    )
+
+    // Document the ports that this component has
+    // {"Port name", "Description", { "list of event types that the port can handle"} }
+    SST_ELI_DOCUMENT_PORTS(
+        {"nocPort_%(processorNum)d",  "Link to the cache of each processor", { "xtsim.CacheEvent", ""} },
+		{"memPort",  "Link to Memory", { "xtsim.CacheEvent", ""} }
+    )
+
+    // Optional since there is nothing to document - see statistics example for more info
+    SST_ELI_DOCUMENT_STATISTICS( )
+
+    // Optional since there is nothing to document - see SubComponent examples for more info
+    SST_ELI_DOCUMENT_SUBCOMPONENT_SLOTS( )
+
+// Class members
+
+    // Constructor. Components receive a unique ID and the set of parameters that were assigned in the Python input.
+    XTSimNoC(SST::ComponentId_t id, SST::Params& params);
+
+    // Destructor
+    ~XTSimNoC();
+
+private:
+	// event handlers
+	void handleEvent(SST::Event* ev);
+	void handleMemEvent(SST::Event* ev);
+	void handleHop(SST::Event* ev);
+
+	// coherence layer, same transaction semantics as XTSimBus
+	void startTransaction(CacheEvent* ev);
+	void launch(uint32_t tag);
+	void handleSnoopResponse(pid_t pid, EVENT_TYPE rsp, uint32_t tag);
+	void retire(uint32_t tag);
+	void releaseLine(size_t line);
+	void respond(BusSlot_t& slot, EVENT_TYPE rsp, DATA_SRC src);
+	void deliver(NocPacket_t& pkt);
+	uint32_t allocSlot();
+
+	// network layer
+	void buildTopology();
+	void inject(NocPacketType_t type, const CacheEvent& payload, size_t src, size_t dst, bool data);
+	size_t route(size_t cur, size_t dst);
+	bool forward(uint32_t id, size_t linkId);
+	void releaseCredit(int linkId, int vc, size_t flits);
+	void drainRetries();
+	int findVc(NocLink_t& link, NocPacket_t& pkt);
+	// the first cache to enter the region of interest resets the statistics and those behind the memory port
+	void beginRoi(CacheEvent* ev);
+	void finish() override;
+
+    // SST Output object, for printing, error messages, etc.
+    SST::Output* out;
+
+    // Links
+    vector<SST::Link*> links;
+	SST::Link* memLink;
+	SST::Link* hopLink;
+	TimeConverter* nocTc;
+
+	// parameters
+	size_t processorNum;
+	NocTopology_t topology;
+	size_t meshX;
+	size_t meshY;
+	size_t nrouters;
+	size_t memoryNode;
+	SimTime_t routerLatency;
+	SimTime_t linkLatency;
+	size_t linkBandwidth;
+	size_t numVCs;
+	size_t vcBufferDepth;
+	size_t blockSize;
+	size_t controlFlits;
+	size_t dataFlits;
+	size_t hotspotTopN;
+	size_t configId;
+
+	// network state, link id is router * ports + output direction
+	size_t ports;
+	vector<NocLink_t> nocLinks;
+	vector<NocPacket_t> packets;
+	vector<uint32_t> freePackets;
+	deque<size_t> retryLinks; // links whose blocked packets may move again
+
+	// coherence transactions
+	vector<BusSlot_t> slots;
+	vector<uint32_t> freeSlots;
+
+	// transactions per line, a later one to the same line starts snooping when the earlier one retired
+	std::unordered_map<size_t, LineQueue_t> busyLines;
+	size_t lineConflicts = 0;
+
+	// nullptr unless checkCoherence is set
+	CoherenceChecker* checker;
+
+	/* statistics */
+	size_t packetsDelivered = 0;
+	size_t totalHops = 0;
+	SimTime_t totalLatency = 0;
+	size_t packetsByType[4] = {0, 0, 0, 0};
+	size_t memoryTraffic = 0;
+	SimTime_t elapsedCycles = 0;
+	bool roiStarted = false;
+	SimTime_t roiCycle = 0;
+};
+} // namespace xtsim
+} // namespace SST
+#endif
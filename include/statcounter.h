@@ -0,0 +1,98 @@
+#ifndef _XTSIM_STATCOUNTER_H
+#define _XTSIM_STATCOUNTER_H
+
+#include <sst/core/component.h>
+#include <vector>
+#include <stdint.h>
+
+namespace SST {
+namespace xtsim {
+
+/*
+ * A plain integer counter for the hot paths that feeds an SST statistic in batches.
+ *
+ * Counting only touches the local value. flush() hands everything counted since
+ * the last flush to the bound statistic in one call, as that many samples of 1
+ * for event counts or as one sample of the total for quantities such as cycles.
+ * count() is always exact, so the [xxx-stat] reports read the counter directly.
+ */
+class StatCounter {
+public:
+    void bind(Statistic<uint64_t>* stat, bool sum) { this->stat = stat; this->sum = sum; }
+
+    void operator++(int) { pending++; }
+    StatCounter& operator+=(uint64_t n) { pending += n; return *this; }
+
+    uint64_t count() const { return flushed + pending; }
+    operator uint64_t() const { return count(); }
+
+    void flush() {
+        if (pending == 0)
+            return;
+        if (stat) {
+            if (sum) {
+                stat->addData(pending);
+            } else {
+                stat->addDataNTimes(pending, 1);
+            }
+        }
+        flushed += pending;
+        pending = 0;
+    }
+
+    // Count from zero again, only what is counted from here on reaches the statistic after a held set
+    void reset() {
+        pending = 0;
+        flushed = 0;
+    }
+
+private:
+    Statistic<uint64_t>* stat = nullptr;
+    bool sum = false;
+    uint64_t pending = 0;
+    uint64_t flushed = 0;
+};
+
+/*
+ * The counters of one component, flushed together every statFlushPeriod and at finish.
+ *
+ * A held set flushes nothing until reset(), so with roiMode 2 the warmup before the
+ * region of interest never reaches the statistics and reset() starts them from zero.
+ */
+class StatCounterSet {
+public:
+    void add(StatCounter& counter, Statistic<uint64_t>* stat, bool sum = false) {
+        counter.bind(stat, sum);
+        counters.push_back(&counter);
+    }
+
+    void hold() { held = true; }
+
+    void flush() {
+        if (held)
+            return;
+        for (StatCounter* counter : counters)
+            counter->flush();
+    }
+
+    // The flush at finish, a set still held never saw the region of interest and flushes everything
+    void flushFinal() {
+        held = false;
+        flush();
+    }
+
+    void reset() {
+        held = false;
+        for (StatCounter* counter : counters)
+            counter->reset();
+    }
+
+private:
+    std::vector<StatCounter*> counters;
+    bool held = false;
+};
+
+}
+}
+
+#endif
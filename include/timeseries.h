@@ -0,0 +1,61 @@
+#ifndef _XTSIM_TIMESERIES_H
+#define _XTSIM_TIMESERIES_H
+
+#include <sst/core/component.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace SST {
+namespace xtsim {
+
+/*
+ * Periodic samples of one component written as a CSV time series.
+ *
+ * Every row starts with the simulated time in ns and the wall-clock seconds
+ * since the series was opened, followed by one value per column. LEVEL
+ * columns are written as sampled (queue depths, outstanding requests),
+ * DELTA columns take a running count and write what was added since the
+ * previous row, RATE columns do the same and add the count per simulated
+ * second and per wall-clock second of the interval.
+ */
+class TimeSeries {
+public:
+    enum Kind { LEVEL, DELTA, RATE };
+
+    struct Column_t {
+        std::string name;
+        Kind kind;
+    };
+
+    ~TimeSeries() { close(); }
+
+    // Create <prefix><name>.csv and write its header, out reports a file that cannot be created
+    void open(SST::Output* out, const std::string& prefix, const std::string& name, const std::vector<Column_t>& columns);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+
+    // Write one row at simulated time now (ns), one value per column in open() order
+    void sample(SimTime_t now, const std::vector<uint64_t>& values);
+
+    // The running counts were reset, the next row measures DELTA and RATE columns from zero
+    void rebase() { last.assign(columns.size(), 0); }
+
+    // Wall-clock seconds since open()
+    double wallSeconds() const;
+
+private:
+    FILE* file = nullptr;
+    std::vector<Column_t> columns;
+    std::vector<uint64_t> last; // running counts at the previous row, for DELTA and RATE columns
+    SimTime_t lastNs = 0;
+    double lastWall = 0.0;
+    std::chrono::steady_clock::time_point opened;
+};
+
+}
+}
+
+#endif
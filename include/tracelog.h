@@ -0,0 +1,154 @@
+#ifndef _XTSIM_TRACELOG_H
+#define _XTSIM_TRACELOG_H
+
+#include <sst/core/component.h>
+#include <sst/core/output.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <stdio.h>
+#include "event.h"
+
+namespace SST {
+namespace xtsim {
+
+/*
+ * Binary transaction event log.
+ *
+ * The records are only compiled in with -DXTSIM_TRACE (e.g. configure with
+ * CPPFLAGS=-DXTSIM_TRACE), otherwise XTSIM_TRACE_RECORD is a constant false
+ * branch the compiler drops, the call sites are still type checked but the
+ * hot paths carry no trace code. A component with traceEnable
+ * set appends fixed-size records to its own buffer, a full buffer is handed
+ * to one writer thread shared by all components, so the simulation never
+ * waits on the file system. Each component writes <tracePrefix><name>.xtl,
+ * tools/decode_tracelog.py merges the files into one timeline.
+ */
+
+// What a record describes, also the bit of the kind in traceKinds
+enum class TraceKind : uint8_t {
+    CPU_REQ = 0,    // cache: processor access, from = 1 on a hit
+    STATE = 1,      // cache: line state from -> to (CacheState_t), event is the cause
+    EVICT = 2,      // cache: victim line, from = its state, to = 1 if written back
+    BUS_REQ = 3,    // cache: request sent to the bus after its grant
+    SNOOP = 4,      // cache: snoop of event answered with from = response (EVENT_TYPE), aux = requester
+    ARB_REQ = 5,    // arbiter or integrated bus arbitration: request queued, aux = core
+    ARB_GRANT = 6,  // arbiter or integrated bus arbitration: grant, aux = core
+    BUS_START = 7,  // bus: transaction snoops the caches, from = 1 if it joined a memory fill, aux = bus tag
+    BUS_WAIT = 8,   // bus: transaction waits behind another one on its line, aux = bus tag
+    BUS_MEM = 9,    // bus: read or write back sent to memory, aux = channel
+    BUS_RETIRE = 10, // bus: transaction retired, from = reply (EVENT_TYPE), aux = bus tag
+    MEM_ARRIVE = 11, // memory: request queued
+    MEM_ISSUE = 12, // memory: request issued to DRAM, from = row hit(0)/miss(1)/conflict(2)
+    NUM_KINDS
+};
+
+struct TraceRecord_t {
+    uint64_t time;          // simulated ns
+    uint64_t transactionId;
+    uint64_t addr;
+    uint16_t component;     // id from the file header
+    uint8_t kind;           // TraceKind
+    uint8_t event;          // EVENT_TYPE
+    uint8_t from;
+    uint8_t to;
+    uint16_t aux;
+};
+static_assert(sizeof(TraceRecord_t) == 32, "decode_tracelog.py reads 32-byte records");
+
+// Writes the full buffers of every TraceLog from one background thread
+class TraceWriter {
+public:
+    static TraceWriter& instance();
+    ~TraceWriter();
+
+    // Queue records for file, close the file after them when last is set
+    void submit(FILE* file, std::vector<TraceRecord_t>&& records, bool last);
+
+    // An empty buffer with room for capacity records, reused from written ones
+    std::vector<TraceRecord_t> spare(size_t capacity);
+
+private:
+    struct Chunk_t {
+        FILE* file;
+        std::vector<TraceRecord_t> records;
+        bool last;
+    };
+
+    TraceWriter() = default;
+    void run();
+
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<Chunk_t> chunks;
+    std::vector<std::vector<TraceRecord_t>> free;
+    std::thread thread;
+    bool started = false;
+    bool stopping = false;
+};
+
+class TraceLog {
+public:
+    ~TraceLog() { close(); }
+
+    // Read the trace* parameters and open <tracePrefix><name>.xtl when traceEnable is set
+    void open(SST::Params& params, SST::Output* out, const std::string& name);
+
+    // Hand the buffered records and the file over to the writer
+    void close();
+
+    void record(SimTime_t now, TraceKind kind, size_t transactionId, size_t addr, EVENT_TYPE event,
+        uint8_t from = 0, uint8_t to = 0, uint16_t aux = 0) {
+        if (now < startNs || now >= stopNs || addr < addrLow || addr >= addrHigh || !(kinds & (1u << (int) kind)))
+            return;
+        buffer.push_back({now, transactionId, addr, id, (uint8_t) kind, (uint8_t) event, from, to, aux});
+        if (buffer.size() == capacity)
+            flush();
+    }
+
+    bool on = false;
+
+private:
+    void flush();
+
+    FILE* file = nullptr;
+    uint16_t id = 0;
+    std::vector<TraceRecord_t> buffer;
+    size_t capacity = 0;
+
+    // runtime filters
+    SimTime_t startNs = 0;
+    SimTime_t stopNs = ~0ull;
+    size_t addrLow = 0;
+    size_t addrHigh = ~0ull;
+    uint32_t kinds = ~0u;
+};
+
+#ifdef XTSIM_TRACE
+const bool XTSIM_TRACE_COMPILED = true;
+#else
+const bool XTSIM_TRACE_COMPILED = false;
+#endif
+
+// The trace parameters every traced component documents in SST_ELI_DOCUMENT_PARAMS
+#define XTSIM_TRACE_PARAMS \
+    { "traceEnable", "Write the binary transaction log <tracePrefix><name>.xtl, needs a -DXTSIM_TRACE build (0 or 1)", "0"}, \
+    { "tracePrefix", "Path prefix of the transaction log", ""}, \
+    { "traceStart", "Simulated ns the log starts at", "0"}, \
+    { "traceStop", "Simulated ns the log stops at, 0 runs to the end", "0"}, \
+    { "traceAddrLow", "Lowest address logged", "0"}, \
+    { "traceAddrHigh", "Address the logged range ends before, 0 logs every address", "0"}, \
+    { "traceKinds", "Comma-separated record kinds to log, e.g. STATE,BUS_START,BUS_RETIRE, or all", "all"}, \
+    { "traceBufferRecords", "Records buffered per component before they go to the writer thread", "8192"}
+
+// The arguments are only evaluated when a record is taken
+#define XTSIM_TRACE_RECORD(log, ...) do { if (XTSIM_TRACE_COMPILED && (log).on) (log).record(__VA_ARGS__); } while (0)
+
+}
+}
+
+#endif
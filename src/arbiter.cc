@@ -46,14 +46,11 @@ XTSimArbiter::XTSimArbiter(ComponentId_t id, Params &params) : Component(id) {
     // Get parameter from the Python input
     // bool found;
     processorNum = params.find<size_t>("processorNum");
-	grantsNum = vector<size_t>(processorNum, 0);
-	maxBusTransactions = params.find<size_t>("maxBusTransactions");
-	int arbPolicyInt = params.find<int>("arbPolicy");
-	if(arbPolicyInt == 0){
-		arbPolicy = ArbPolicy::FIFO;
-	}else if(arbPolicyInt == 1){
-		arbPolicy = ArbPolicy::RR;
-	}
+    if (processorNum == 0 || processorNum > MAX_BUS_AGENTS) {
+        out->fatal(CALL_INFO, -1, "Error! %s supports 1 to %zu processors, got %zu\n", getName().c_str(), MAX_BUS_AGENTS, processorNum);
+    }
+	configId = params.find<size_t>("configId", 0);
+	arbitration = new Arbitration(processorNum, Arbitration::readConfig(params, out, getName(), processorNum));
 
     // Tell the simulation not to end until we're ready
     // registerAsPrimaryComponent();
@@ -62,105 +59,130 @@ XTSimArbiter::XTSimArbiter(ComponentId_t id, Params &params) : Component(id) {
     // configure our link with a callback function that will be called whenever an event arrives
     // Callback function is optional, if not provided then component must poll the link
 	links.resize(processorNum);
-	for(int i = 0 ;i < processorNum; ++i){
+	for(size_t i = 0 ;i < processorNum; ++i){
 		string portName = "arbiterPort_" + std::to_string(i);
 		links[i] = configureLink(portName, new Event::Handler<XTSimArbiter>(this, &XTSimArbiter::handleEvent));
 		sst_assert(links[i], CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
 	}
-}
+	wakeupLink = configureSelfLink("wakeup", "1ns", new Event::Handler<XTSimArbiter>(this, &XTSimArbiter::handleWakeup));
 
-void XTSimArbiter::getNext(){
-	rrList.erase(acIter);
-	if(rrList.empty()){
-		return ;
+	// grants only bump local counters, they reach the statistics every statFlushPeriod and at finish
+	for (size_t i = 0; i < processorNum; ++i) {
+		string core = std::to_string(i);
+		ArbWaitStats_t& stats = arbitration->stats(i);
+		counters.add(stats.grants, registerStatistic<uint64_t>("grants", core));
+		counters.add(stats.waitSum, registerStatistic<uint64_t>("grantWait", core), true);
+		counters.add(stats.starved, registerStatistic<uint64_t>("starvedGrants", core));
 	}
-	while(true){
-		for(auto it = rrList.begin(); it != rrList.end(); ++it){
-			if(it->pid == nextPid){
-				acIter = it;
-				nextPid ++;
-				nextPid %= processorNum;
-				return;
-			}
-		}
-		nextPid ++;
-		nextPid %= processorNum;
+	string flushPeriod = params.find<string>("statFlushPeriod", "10us");
+	if (flushPeriod != "0")
+		registerClock(flushPeriod, new Clock::Handler<XTSimArbiter>(this, &XTSimArbiter::flushStats), false);
+	// grants before the region of interest stay out of the statistics with roiMode 2
+	if (params.find<size_t>("roiMode", 0) == 2)
+		counters.hold();
+	string sampleInterval = params.find<string>("sampleInterval", "0");
+	if (sampleInterval != "0") {
+		series.open(out, params.find<string>("timeSeriesPrefix", ""), getName(), {
+			{"queued", TimeSeries::LEVEL}, {"granted", TimeSeries::LEVEL}, {"grants", TimeSeries::DELTA}});
+		registerClock(sampleInterval, new Clock::Handler<XTSimArbiter>(this, &XTSimArbiter::sampleTic), false);
 	}
+	trace.open(params, out, getName());
+
+	string checkpointIn = params.find<string>("checkpointIn", "");
+	if (!checkpointIn.empty())
+		Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+	checkpointOut = params.find<string>("checkpointOut", "");
 }
 
 void XTSimArbiter::handleEvent(SST::Event* ev){
 	ArbEvent* arbEvent = dynamic_cast<ArbEvent*>(ev);
 	// printf("arbiter received event with type: %d from pid:%d\n", arbEvent->event_type, arbEvent->pid);
 
-	ArbEvent *localArbEvent = new ArbEvent(arbEvent->event_type, arbEvent->pid);
-	delete arbEvent;
-	// if receiving a release event
-	if(localArbEvent->event_type == ARB_EVENT_TYPE::RL){
-		// printf("RL\n");
-		if(arbPolicy == ArbPolicy::FIFO){
-			fifoQueue.pop();
-			if(fifoQueue.empty()) {
-				delete localArbEvent;
-				return;
-			} 
-		}
-		else{
-			getNext();
-			if(rrList.empty()) {
-				delete localArbEvent;
-				return;
-			}
-		}
-		sendEvent();
-		delete localArbEvent;
+	// a release frees a grant for the next request, an acquire queues one for its core
+	if (arbEvent->event_type == ARB_EVENT_TYPE::RS) {
+		if (!roiStarted)
+			resetStats();
+		delete arbEvent;
 		return;
 	}
-
-	// else if receiving an acquire event
-	if(arbPolicy == ArbPolicy::FIFO){
-		// printf("AC\n");
-		fifoQueue.push(*localArbEvent);
-		if(fifoQueue.size() <= maxBusTransactions){
-			sendEvent();
-		}
-	} else if(arbPolicy == ArbPolicy::RR){
-		rrList.push_back(*localArbEvent);
-		if(rrList.size() <= maxBusTransactions){
-			sendEvent();
-		}
+	if(arbEvent->event_type == ARB_EVENT_TYPE::RL){
+		if (!arbitration->release(arbEvent->pid))
+			out->fatal(CALL_INFO, -1, "Error! %s: cache%d released the bus with no grant outstanding\n", getName().c_str(), arbEvent->pid);
+	} else {
+		arbitration->request(arbEvent->pid, getCurrentSimTimeNano());
+		XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::ARB_REQ, 0, 0, EVENT_TYPE::EMPTY, 0, 0, arbEvent->pid);
 	}
-	delete localArbEvent;
+	delete arbEvent;
+	sendEvent();
+}
+
+void XTSimArbiter::handleWakeup(SST::Event* ev){
+	delete ev;
+	wakeupAt = 0;
+	sendEvent();
 }
 
 void XTSimArbiter::sendEvent(){
 	// printf("arb sendEvent\n");
-	if(arbPolicy == ArbPolicy::FIFO){
-		ArbEvent *ev = new ArbEvent;
-		ev->pid = fifoQueue.front().pid;
-		ev->event_type = fifoQueue.front().event_type;
-		grantsNum[ev->pid] ++;
-		// printf("pid: %d\n", ev->pid);
-		links[ev->pid]->send(ev);
-		// printf("[arbiter]: granted access to %d\n", ev->pid);
+	SimTime_t now = getCurrentSimTimeNano();
+	int pid;
+	while ((pid = arbitration->next(now)) >= 0) {
+		links[pid]->send(new ArbEvent(ARB_EVENT_TYPE::AC, pid));
+		XTSIM_TRACE_RECORD(trace, now, TraceKind::ARB_GRANT, 0, 0, EVENT_TYPE::EMPTY, 0, 0, pid);
+		// printf("[arbiter]: granted access to %d\n", pid);
+	}
+
+	// nothing else wakes the arbiter when the waiting cores do not own the current TDM slot
+	SimTime_t retry = arbitration->retryAt(now);
+	if (retry && wakeupAt == 0) {
+		wakeupAt = retry;
+		wakeupLink->send(retry - now, new ArbEvent(ARB_EVENT_TYPE::AC, -1));
 	}
-	else{
-		ArbEvent *ev = new ArbEvent;
-		ev->pid = acIter->pid;
-		ev->event_type = acIter->event_type;
-		grantsNum[ev->pid] ++;
-		links[ev->pid]->send(ev);
-		// printf("[arbiter]: granted access to %d\n", ev->pid);
+}
+
+void XTSimArbiter::finish(){
+	arbitration->finish(getCurrentSimTimeNano());
+	counters.flushFinal();
+	trace.close();
+	if (!checkpointOut.empty()) {
+		// a grant still held here is only the last release on its way, queued requests are lost
+		if (arbitration->queued())
+			out->output("%s: %zu queued requests are not part of the checkpoint\n", getName().c_str(), arbitration->queued());
+		Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
 	}
 }
 
+void XTSimArbiter::warmState(Serializer_t& ser){
+	Checkpoint::expect(ser, out, getName(), "processorNum", processorNum);
+	arbitration->checkpoint(ser);
+}
+
+void XTSimArbiter::resetStats(){
+	roiStarted = true;
+	counters.reset();
+	series.rebase();
+	arbitration->resetStats();
+}
+
+bool XTSimArbiter::flushStats(Cycle_t cycle){
+	counters.flush();
+	return false;
+}
+
+bool XTSimArbiter::sampleTic(Cycle_t cycle){
+	uint64_t grants = 0;
+	for (size_t i = 0; i < processorNum; ++i)
+		grants += arbitration->stats(i).grants.count();
+	series.sample(getCurrentSimTimeNano(), {arbitration->queued(), arbitration->granted(), grants});
+	return false;
+}
+
 /*
  * Destructor, clean up our output
  */
 XTSimArbiter::~XTSimArbiter()
 {
     delete out;
-	string content;
-	for(auto& num : grantsNum)
-		content += std::to_string(num) + " ";
-	printf("[arbiter-stat]: final granting statistics:\n %s\n", content.c_str());
+	arbitration->report(configId);
+	delete arbitration;
 }
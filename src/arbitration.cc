@@ -0,0 +1,247 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/arbitration.h"
+#include <algorithm>
+
+using namespace SST;
+using namespace SST::xtsim;
+
+Arbitration::Arbitration(size_t nagents, const ArbConfig_t& config) :
+    nagents(nagents), config(config),
+    held(nagents, 0), queues(nagents), pendingMask((nagents + 63) / 64, 0), waitStats(nagents) {
+    // missing per-core values default to weight 1 and priority 0
+    this->config.weights.resize(nagents, 1);
+    this->config.priorities.resize(nagents, 0);
+    for (size_t i = 0; i < nagents; i++) {
+        for (size_t s = 0; s < this->config.weights[i]; s++)
+            tdmTable.push_back(i);
+    }
+}
+
+ArbConfig_t Arbitration::readConfig(SST::Params& params, SST::Output* out, const std::string& name, size_t nagents) {
+	ArbConfig_t config;
+	config.maxGrants = params.find<size_t>("maxBusTransactions", 1);
+	int arbPolicyInt = params.find<int>("arbPolicy", 0);
+	if (arbPolicyInt < 0 || arbPolicyInt > (int) ArbPolicy::PRIORITY) {
+		out->fatal(CALL_INFO, -1, "Error! Invalid arbitration policy %d for %s\n", arbPolicyInt, name.c_str());
+	}
+	config.policy = (ArbPolicy) arbPolicyInt;
+	if (config.maxGrants == 0) {
+		out->fatal(CALL_INFO, -1, "Error! %s needs maxBusTransactions of at least 1\n", name.c_str());
+	}
+
+	// per-core QoS knobs, cores left out of the lists get weight 1 and priority 0
+	params.find_array<size_t>("weights", config.weights);
+	params.find_array<size_t>("priorities", config.priorities);
+	config.tdmSlot = params.find<SimTime_t>("tdmSlot", 100);
+	config.agingThreshold = params.find<SimTime_t>("agingThreshold", 1000);
+	config.starvationThreshold = params.find<SimTime_t>("starvationThreshold", 10000);
+	if (config.weights.size() > nagents || config.priorities.size() > nagents) {
+		out->fatal(CALL_INFO, -1, "Error! %s got more weights or priorities than processors\n", name.c_str());
+	}
+	for (size_t w : config.weights) {
+		if (w == 0)
+			out->fatal(CALL_INFO, -1, "Error! %s weights must be at least 1\n", name.c_str());
+	}
+	if (config.tdmSlot == 0) {
+		out->fatal(CALL_INFO, -1, "Error! %s needs a non-zero tdmSlot\n", name.c_str());
+	}
+	return config;
+}
+
+void Arbitration::setPending(size_t agent, bool on) {
+    if (on) {
+        pendingMask[agent / 64] |= 1ull << (agent % 64);
+    } else {
+        pendingMask[agent / 64] &= ~(1ull << (agent % 64));
+    }
+}
+
+// first agent with a queued request at or after from, wrapping around
+int Arbitration::findPending(size_t from) {
+    size_t nwords = pendingMask.size();
+    size_t w = from / 64;
+    uint64_t bits = pendingMask[w] & (~0ull << (from % 64));
+    for (size_t i = 0; i <= nwords; i++) {
+        if (bits)
+            return w * 64 + __builtin_ctzll(bits);
+        w = (w + 1) % nwords;
+        bits = pendingMask[w];
+    }
+    return -1;
+}
+
+void Arbitration::request(size_t agent, SimTime_t now) {
+    queues[agent].push_back(now);
+    setPending(agent, true);
+    npending++;
+    if (config.policy == ArbPolicy::FIFO)
+        arrivalOrder.push_back(agent);
+}
+
+bool Arbitration::release(size_t agent) {
+    if (agent >= nagents || held[agent] == 0)
+        return false;
+    held[agent]--;
+    active--;
+    return true;
+}
+
+int Arbitration::pickWrr() {
+    int agent = findPending(rrNext);
+    if (agent < 0)
+        return -1;
+    if (agent != (int) rrNext || wrrCredits == 0)
+        wrrCredits = config.weights[agent];
+    // stay on this core while it has credits left
+    if (--wrrCredits > 0) {
+        rrNext = agent;
+    } else {
+        rrNext = (agent + 1) % nagents;
+    }
+    return agent;
+}
+
+// scans the pending agents only, starting at the round robin pointer so ties rotate
+int Arbitration::pickAge(SimTime_t now) {
+    int best = -1;
+    SimTime_t bestAge = 0;
+    int first = findPending(rrNext);
+    for (int agent = first; agent >= 0;) {
+        SimTime_t age = (now - queues[agent].front() + 1) * config.weights[agent];
+        if (best < 0 || age > bestAge) {
+            best = agent;
+            bestAge = age;
+        }
+        agent = findPending((agent + 1) % nagents);
+        if (agent == first)
+            break;
+    }
+    if (best >= 0)
+        rrNext = (best + 1) % nagents;
+    return best;
+}
+
+int Arbitration::pickTdm(SimTime_t now) {
+    size_t owner = tdmTable[(now / config.tdmSlot) % tdmTable.size()];
+    return queues[owner].empty() ? -1 : owner;
+}
+
+int Arbitration::pickPriority(SimTime_t now) {
+    int best = -1;
+    SimTime_t bestLevel = 0;
+    int first = findPending(rrNext);
+    for (int agent = first; agent >= 0;) {
+        SimTime_t level = config.priorities[agent];
+        if (config.agingThreshold)
+            level += (now - queues[agent].front()) / config.agingThreshold;
+        if (best < 0 || level > bestLevel) {
+            best = agent;
+            bestLevel = level;
+        }
+        agent = findPending((agent + 1) % nagents);
+        if (agent == first)
+            break;
+    }
+    if (best >= 0)
+        rrNext = (best + 1) % nagents;
+    return best;
+}
+
+int Arbitration::next(SimTime_t now) {
+    if (active >= config.maxGrants || npending == 0)
+        return -1;
+    int agent;
+    switch (config.policy) {
+        case ArbPolicy::FIFO:
+            agent = arrivalOrder.front();
+            arrivalOrder.pop_front();
+            break;
+        case ArbPolicy::WRR:
+            agent = pickWrr();
+            break;
+        case ArbPolicy::AGE:
+            agent = pickAge(now);
+            break;
+        case ArbPolicy::TDM:
+            agent = pickTdm(now);
+            break;
+        case ArbPolicy::PRIORITY:
+            agent = pickPriority(now);
+            break;
+        default:
+            agent = findPending(rrNext);
+            if (agent >= 0)
+                rrNext = (agent + 1) % nagents;
+    }
+    if (agent < 0)
+        return -1;
+
+    SimTime_t wait = now - queues[agent].front();
+    ArbWaitStats_t& stats = waitStats[agent];
+    stats.grants++;
+    stats.waitSum += wait;
+    stats.waitMax = std::max(stats.waitMax, wait);
+    if (wait > config.starvationThreshold)
+        stats.starved++;
+
+    queues[agent].pop_front();
+    if (queues[agent].empty())
+        setPending(agent, false);
+    npending--;
+    held[agent]++;
+    active++;
+    return agent;
+}
+
+SimTime_t Arbitration::retryAt(SimTime_t now) {
+    if (config.policy != ArbPolicy::TDM || active >= config.maxGrants || npending == 0)
+        return 0;
+    return (now / config.tdmSlot + 1) * config.tdmSlot;
+}
+
+size_t Arbitration::starving(SimTime_t now) {
+    size_t n = 0;
+    for (size_t i = 0; i < nagents; i++) {
+        if (!queues[i].empty() && now - queues[i].front() > config.starvationThreshold)
+            n++;
+    }
+    return n;
+}
+
+void Arbitration::report(size_t configId) {
+	std::string content;
+	double sum = 0, sumSq = 0;
+	for(size_t i = 0; i < nagents; i++) {
+		size_t grants = waitStats[i].grants;
+		content += std::to_string(grants) + " ";
+		sum += grants;
+		sumSq += (double) grants * grants;
+	}
+	printf("[arbiter-stat]: config%zu final granting statistics:\n %s\n", configId, content.c_str());
+	for(size_t i = 0; i < nagents; i++) {
+		const ArbWaitStats_t& stats = waitStats[i];
+		printf("[arbiter-stat]: config%zu core%zu grants:%zu mean wait:%f ns max wait:%lu ns starved:%zu\n", configId, i,
+			stats.grants.count(), stats.grants ? (double) stats.waitSum / stats.grants : 0.0, stats.waitMax, stats.starved.count());
+	}
+	// Jain's index, 1 when every core got the same number of grants
+	printf("[arbiter-stat]: config%zu grant fairness:%f starving cores at exit:%zu\n", configId,
+		sumSq ? sum * sum / (nagents * sumSq) : 1.0, starvingAtExit);
+}
@@ -21,6 +21,7 @@
 #include "./include/event.h"
 #include "./include/cache.h"
 #include <string>
+#include <algorithm>
 
 using namespace SST;
 using namespace SST::xtsim;
@@ -67,10 +68,57 @@ cache::cache(ComponentId_t id, Params& params) : Component(id) {
     // Failure usually means the user didn't connect the port in the input file
     // sst_assert(cpulink, CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
 
-    nhits = registerStatistic<uint64_t>("hits");
-    nmisses = registerStatistic<uint64_t>("misses");
-    nevictions = registerStatistic<uint64_t>("evictions");
-    ninvalidations = registerStatistic<uint64_t>("invalidations");
+    // Accesses only bump local counters, they reach the statistics every statFlushPeriod and at finish
+    counters.add(nhits, registerStatistic<uint64_t>("hits"));
+    counters.add(nmisses, registerStatistic<uint64_t>("misses"));
+    counters.add(nevictions, registerStatistic<uint64_t>("evictions"));
+    counters.add(ninvalidations, registerStatistic<uint64_t>("invalidations"));
+    counters.add(nmissClass[(int) MissClass_t::COMPULSORY], registerStatistic<uint64_t>("compulsoryMisses"));
+    counters.add(nmissClass[(int) MissClass_t::CAPACITY], registerStatistic<uint64_t>("capacityMisses"));
+    counters.add(nmissClass[(int) MissClass_t::CONFLICT], registerStatistic<uint64_t>("conflictMisses"));
+    counters.add(nmissClass[(int) MissClass_t::TRUE_SHARING], registerStatistic<uint64_t>("trueSharingMisses"));
+    counters.add(nmissClass[(int) MissClass_t::FALSE_SHARING], registerStatistic<uint64_t>("falseSharingMisses"));
+    counters.add(mergedMisses, registerStatistic<uint64_t>("mergedMisses"));
+    counters.add(nwritebacks, registerStatistic<uint64_t>("writebacks"));
+    counters.add(upgradeConversions, registerStatistic<uint64_t>("upgradeConversions"));
+    counters.add(upgradeRetries, registerStatistic<uint64_t>("upgradeRetries"));
+    counters.add(nsplits, registerStatistic<uint64_t>("splitAccesses"));
+    counters.add(nsplitLines, registerStatistic<uint64_t>("splitLineAccesses"));
+    bool found;
+    std::string flushPeriod = params.find<std::string>("statFlushPeriod", "10us", found);
+    if (flushPeriod != "0")
+        registerClock(flushPeriod, new Clock::Handler<cache>(this, &cache::flushStats), false);
+    // with roiMode 2 only the accesses from the region of interest on reach the statistics
+    if (params.find<size_t>("roiMode", 0) == 2)
+        counters.hold();
+    std::string sampleInterval = params.find<std::string>("sampleInterval", "0");
+    if (sampleInterval != "0") {
+        series.open(out, params.find<std::string>("timeSeriesPrefix", ""), getName(), {
+            {"hits", TimeSeries::DELTA}, {"misses", TimeSeries::DELTA},
+            {"outstandingMisses", TimeSeries::LEVEL}, {"busQueue", TimeSeries::LEVEL}});
+        registerClock(sampleInterval, new Clock::Handler<cache>(this, &cache::sampleTic), false);
+    }
+    trace.open(params, out, getName());
+
+    // The shadow structure holds as many lines as the cache itself
+    classifier = nullptr;
+    writebackDirty = params.find<bool>("writebackDirty", false, found);
+    integratedArbiter = params.find<bool>("integratedArbiter", false, found);
+    if (params.find<bool>("classifyMisses", false, found)) {
+        classifier = new MissClassifier(nsets * associativity, blockSize, params.find<size_t>("wordSize", 4, found));
+        missClassTopN = params.find<size_t>("missClassTopN", 10, found);
+    }
+    profiler = nullptr;
+    if (params.find<bool>("profileHotspots", false, found)) {
+        profiler = new HotspotProfiler(blockSize, params.find<size_t>("pageSize", 4096, found));
+        hotspotTopN = params.find<size_t>("hotspotTopN", 10, found);
+    }
+
+    // Branch off a warmed up run instead of starting with every line invalid
+    std::string checkpointIn = params.find<std::string>("checkpointIn", "", found);
+    if (!checkpointIn.empty())
+        Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    checkpointOut = params.find<std::string>("checkpointOut", "", found);
 
     printf("Cache %lu initialized with parameters blockSize: %lu cacheSize: %lu sets: %lu nsbits: %lu nbbits: %lu \
     associativity: %lu rpolicy: %d cprotocol: %d\n",  cacheId, blockSize, cacheSize, nsets, nsbits, nbbits, 
@@ -82,16 +130,108 @@ cache::cache(ComponentId_t id, Params& params) : Component(id) {
  */
 cache::~cache()
 {
-    float abshit = (float) nhits->getCollectionCount();
-    float absmiss = (float) nmisses->getCollectionCount();
+    float abshit = (float) nhits.count();
+    float absmiss = (float) nmisses.count();
     float hitrate = abshit / (abshit + absmiss) * 100.f;
     float missrate = absmiss / (absmiss + abshit) * 100.f;
-    printf("[cache-stat]: cache%d hit rate: %f miss rate: %f nhits: %llu nmisses: %llu nevictions: %llu ninvalidations: %llu\n", 
-    cacheId, hitrate, missrate, nhits->getCollectionCount(), nmisses->getCollectionCount(), nevictions->getCollectionCount(), ninvalidations->getCollectionCount());
+    printf("[cache-stat]: config%lu cache%lu hit rate: %f miss rate: %f nhits: %lu nmisses: %lu nevictions: %lu ninvalidations: %lu\n", 
+    configId, cacheId, hitrate, missrate, nhits.count(), nmisses.count(), nevictions.count(), ninvalidations.count());
+    if (writebackDirty) {
+        printf("[cache-stat]: config%lu cache%lu writebacks: %lu\n", configId, cacheId, nwritebacks.count());
+    }
+    if (upgradeConversions || upgradeRetries) {
+        printf("[cache-stat]: config%lu cache%lu upgrades lost to a remote write at grant: %lu after bus order: %lu\n",
+        configId, cacheId, upgradeConversions.count(), upgradeRetries.count());
+    }
+    if (nsplits) {
+        // hits and misses count line accesses, a split access is one access of the processor
+        uint64_t accesses = nhits.count() + nmisses.count() - nsplitLines.count();
+        printf("[cache-stat]: config%lu cache%lu split accesses: %lu (%.2f%% of accesses) extra line accesses: %lu\n",
+        configId, cacheId, nsplits.count(), (double) nsplits.count() / accesses * 100.0, nsplitLines.count());
+    }
+    if (classifier) {
+        printf("[miss-class]: config%lu cache%lu compulsory: %lu capacity: %lu conflict: %lu true sharing: %lu false sharing: %lu merged: %lu\n",
+        configId, cacheId, nmissClass[(int) MissClass_t::COMPULSORY].count(),
+        nmissClass[(int) MissClass_t::CAPACITY].count(), nmissClass[(int) MissClass_t::CONFLICT].count(),
+        nmissClass[(int) MissClass_t::TRUE_SHARING].count(), nmissClass[(int) MissClass_t::FALSE_SHARING].count(),
+        mergedMisses.count());
+        classifier->report(configId, cacheId, missClassTopN);
+        delete classifier;
+    }
+    if (profiler) {
+        profiler->report(configId, cacheId, hotspotTopN);
+        delete profiler;
+    }
     delete out;
 }
 
 
+bool cache::flushStats(Cycle_t cycle) {
+    counters.flush();
+    return false;
+}
+
+bool cache::sampleTic(Cycle_t cycle) {
+    series.sample(getCurrentSimTimeNano(), {nhits.count(), nmisses.count(), outRequest.size(), requestQueue.size()});
+    return false;
+}
+
+void cache::finish() {
+    counters.flushFinal();
+    trace.close();
+    if (!checkpointOut.empty()) {
+        if (!outRequest.empty() || !requestQueue.empty())
+            out->output("%s: %zu outstanding misses are not part of the checkpoint\n", getName().c_str(), outRequest.size() + requestQueue.size());
+        Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    }
+}
+
+// The region of interest starts here, everything before it only warmed the cache up
+void cache::resetStats() {
+    counters.reset();
+    series.rebase();
+    if (classifier)
+        classifier->resetReport();
+    if (profiler)
+        profiler->reset();
+
+    // The shared components reset once, with the first cache that enters the region of interest
+    buslink->send(new CacheEvent(EVENT_TYPE::ROI_BEGIN, 0, cacheId, 0));
+    if (!integratedArbiter)
+        arblink->send(new ArbEvent(ARB_EVENT_TYPE::RS, cacheId));
+}
+
+// Tags, states and replacement metadata, plus the shadow state of the miss classifier when it runs
+void cache::warmState(Serializer_t& ser) {
+    Checkpoint::expect(ser, out, getName(), "cacheSize", cacheSize);
+    Checkpoint::expect(ser, out, getName(), "associativity", associativity);
+    Checkpoint::expect(ser, out, getName(), "blockSize", blockSize);
+    Checkpoint::expect(ser, out, getName(), "protocol", (size_t) cprotocol);
+    Checkpoint::expect(ser, out, getName(), "cacheId", cacheId);
+    ser & timestamp;
+    for (std::vector<CacheLine_t>& cacheSet : cacheLines) {
+        for (CacheLine_t& line : cacheSet) {
+            ser & line.valid;
+            ser & line.address;
+            ser & line.dirty;
+            ser & line.timestamp;
+            ser & line.state;
+        }
+    }
+    ser & rrCounter;
+    bool classified = classifier != nullptr;
+    ser & classified;
+    if (classified) {
+        if (classifier) {
+            classifier->checkpoint(ser);
+        } else {
+            // this run does not classify, step over the saved shadow state
+            MissClassifier unused(nsets * associativity, blockSize, 4);
+            unused.checkpoint(ser);
+        }
+    }
+}
+
 /* Event handler
  * Incoming events are scanned and deleted
  * Record if the event received is the last one our neighbor will send 
@@ -102,7 +242,15 @@ void cache::handleProcessorOp(SST::Event *ev)
     // printf("Received processor instr %lx\n", event->addr);
     if (event) {
         timestamp++;
-        handleProcessorEvent(event);
+        if (event->roiBegin)
+            resetStats();
+        size_t first = event->addr / blockSize;
+        size_t last = event->size ? (event->addr + event->size - 1) / blockSize : first;
+        if (last == first) {
+            handleProcessorEvent(event);
+        } else {
+            splitAccess(event, first, last);
+        }
         // Receiver has the responsiblity for deleting events
     } else {
         out->fatal(CALL_INFO, -1, "Error! Bad Event Type received by %s!\n", getName().c_str());
@@ -112,9 +260,13 @@ void cache::handleProcessorOp(SST::Event *ev)
 
 void cache::handleProcessorEvent(CacheEvent* event) {
     CacheLine_t* line = lookupCache(event->addr);
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::CPU_REQ, event->transactionId, event->addr,
+        event->event_type, line != nullptr);
     if (line != nullptr) { // Cache hit
         // printf("Cache hit %lx %lu %d %d\n", event->addr, event->addr / blockSize, cacheId, event->event_type);
-        nhits->addData(1);
+        nhits++;
+        if (classifier)
+            classifier->access(event->addr);
         if (event->event_type == EVENT_TYPE::PR_RD) {
             handleReadHit(event, line);
         } else if (event->event_type == EVENT_TYPE::PR_WR) {
@@ -123,7 +275,11 @@ void cache::handleProcessorEvent(CacheEvent* event) {
             out->fatal(CALL_INFO, -1, "Error! Bad Event Type received by %s!\n", getName().c_str());
         }
     } else { // Cache miss
-        nmisses->addData(1);
+        nmisses++;
+        if (classifier)
+            classifyMiss(event);
+        if (profiler)
+            profiler->miss(event->addr, event->pc);
         // printf("Cache miss %lx %lu %d %d\n", event->addr, event->addr / blockSize, cacheId, event->event_type);
         if (event->event_type == EVENT_TYPE::PR_RD) {
             handleReadMiss(event);
@@ -135,14 +291,52 @@ void cache::handleProcessorEvent(CacheEvent* event) {
     }
 }
 
+// An access crossing line boundaries becomes one request per line, the
+// processor gets a single response once the last of them completed
+void cache::splitAccess(CacheEvent* event, size_t first, size_t last) {
+    nsplits++;
+    nsplitLines += last - first;
+    splitAccesses[event->transactionId] = SplitAccess_t{last - first + 1, event->addr};
+    size_t end = event->addr + event->size;
+    for (size_t lineIdx = first; lineIdx <= last; lineIdx++) {
+        CacheEvent part(*event);
+        part.addr = std::max(event->addr, lineIdx * blockSize);
+        part.size = std::min(end, (lineIdx + 1) * blockSize) - part.addr;
+        handleProcessorEvent(&part);
+    }
+}
+
+// Every response to the processor goes through here, parts of a split access wait for each other.
+// Merged misses (aliases) carry the arbiter wait and bus time of the transaction they waited on.
+void cache::respond(CacheEvent* event) {
+    auto split = splitAccesses.find(event->transactionId);
+    if (split != splitAccesses.end()) {
+        if (--split->second.parts > 0) {
+            delete event;
+            return;
+        }
+        event->addr = split->second.addr;
+        splitAccesses.erase(split);
+    }
+    // misses come back as the bus transaction that served them, the processor sees its own access type
+    if (event->event_type == EVENT_TYPE::BUS_RD) {
+        event->event_type = EVENT_TYPE::PR_RD;
+    } else if (event->event_type == EVENT_TYPE::BUS_RDX || event->event_type == EVENT_TYPE::BUS_UPGR) {
+        event->event_type = EVENT_TYPE::PR_WR;
+    }
+    cpulink->send(event);
+}
+
 void cache::handleOutRequestMesi(CacheEvent *event) {
     for (size_t i = 0; i < outRequest.size(); i++) {
         if (event->event_type == outRequest[i].event.event_type && event->pid == outRequest[i].event.pid &&
             event->addr == outRequest[i].event.addr) {
             
-            // Evict the line here itself
+            // Evict the line here itself, unless an earlier request of ours already brought it in
             
-            CacheLine_t& line = evictLine(event);
+            CacheLine_t* present = lookupCache(event->addr);
+            CacheState_t before = present ? present->state : CacheState_t::I;
+            CacheLine_t& line = present ? *present : evictLine(event);
             if (event->event_type == EVENT_TYPE::BUS_RD) {
                 if (event->rsp == EVENT_TYPE::SHARED) {
                     line.state = CacheState_t::S;
@@ -158,11 +352,16 @@ void cache::handleOutRequestMesi(CacheEvent *event) {
             line.timestamp = timestamp;
             line.valid = true;
             line.address = event->addr;
+            XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::STATE, event->transactionId, event->addr,
+                event->event_type, (uint8_t) before, (uint8_t) line.state);
 
-            // Send back all aliased events back to CPU
+            // Send back all aliased events back to CPU, they waited on this transaction
             for (size_t j = 0; j < outRequest[i].alias.size(); j++) {
                 CacheEvent *newCpuEvent = new CacheEvent(outRequest[i].alias[j]);
-                cpulink->send(newCpuEvent);
+                newCpuEvent->src = event->src;
+                newCpuEvent->arbWait = event->arbWait;
+                newCpuEvent->busTime = event->busTime;
+                respond(newCpuEvent);
             }
             outRequest.erase(outRequest.begin() + i, outRequest.begin()+ i + 1);
             break;
@@ -175,9 +374,11 @@ void cache::handleOutRequestMsi(CacheEvent *event) {
         if (event->event_type == outRequest[i].event.event_type && event->pid == outRequest[i].event.pid &&
             event->addr == outRequest[i].event.addr) {
             
-            // Evict the line here itself
+            // Evict the line here itself, unless an earlier request of ours already brought it in
             
-            CacheLine_t& line = evictLine(event);
+            CacheLine_t* present = lookupCache(event->addr);
+            CacheState_t before = present ? present->state : CacheState_t::I;
+            CacheLine_t& line = present ? *present : evictLine(event);
             if (event->event_type == EVENT_TYPE::BUS_RD) {
                 line.state = CacheState_t::S;
                 line.dirty = false;
@@ -188,11 +389,16 @@ void cache::handleOutRequestMsi(CacheEvent *event) {
             line.timestamp = timestamp;
             line.valid = true;
             line.address = event->addr;
+            XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::STATE, event->transactionId, event->addr,
+                event->event_type, (uint8_t) before, (uint8_t) line.state);
 
-            // Send back all aliased events back to CPU
+            // Send back all aliased events back to CPU, they waited on this transaction
             for (size_t j = 0; j < outRequest[i].alias.size(); j++) {
                 CacheEvent *newCpuEvent = new CacheEvent(outRequest[i].alias[j]);
-                cpulink->send(newCpuEvent);
+                newCpuEvent->src = event->src;
+                newCpuEvent->arbWait = event->arbWait;
+                newCpuEvent->busTime = event->busTime;
+                respond(newCpuEvent);
             }
             outRequest.erase(outRequest.begin() + i, outRequest.begin()+ i + 1);
             break;
@@ -200,7 +406,9 @@ void cache::handleOutRequestMsi(CacheEvent *event) {
     }
 }
 
-void cache::handleOutRequest(CacheEvent *event) {
+bool cache::handleOutRequest(CacheEvent *event) {
+    if (event->event_type == EVENT_TYPE::BUS_UPGR)
+        return completeUpgrade(event);
     switch (cprotocol) {
         case CoherencyProtocol_t::MESI:
             handleOutRequestMesi(event);
@@ -209,82 +417,119 @@ void cache::handleOutRequest(CacheEvent *event) {
             handleOutRequestMsi(event);
             break;
     }
+    return true;
+}
+
+void cache::upgradeLine(CacheEvent* event) {
+    // A write behind a pending upgrade of the same line waits for it
+    for (size_t i = 0; i < outRequest.size(); i++) {
+        if (outRequest[i].event.cacheLineIdx == event->cacheLineIdx) {
+            outRequest[i].alias.push_back(*event);
+            return;
+        }
+    }
+    if (profiler)
+        profiler->upgrade(event->addr, event->pc);
+    OutRequest_t *outreq = new OutRequest_t;
+    outreq->event = *event;
+    outRequest.push_back(*outreq);
+    requestQueue.push_back(*event);
+    acquireBus(event);
+    delete outreq;
+}
+
+// Returns false when a remote BUS_RDX ordered before the upgrade took the line, it is then requested again
+bool cache::completeUpgrade(CacheEvent *event) {
+    for (size_t i = 0; i < outRequest.size(); i++) {
+        if (outRequest[i].event.event_type != EVENT_TYPE::BUS_UPGR || outRequest[i].event.addr != event->addr)
+            continue;
+        CacheLine_t* line = lookupCache(event->addr);
+        if (line == nullptr) {
+            upgradeRetries++;
+            outRequest[i].event.event_type = EVENT_TYPE::BUS_RDX;
+            requestQueue.push_back(outRequest[i].event);
+            acquireBus(&outRequest[i].event);
+            return false;
+        }
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::STATE, event->transactionId, event->addr,
+            event->event_type, (uint8_t) line->state, (uint8_t) CacheState_t::M);
+        line->state = CacheState_t::M;
+        line->dirty = true;
+        line->timestamp = timestamp;
+        for (size_t j = 0; j < outRequest[i].alias.size(); j++) {
+            CacheEvent *newCpuEvent = new CacheEvent(outRequest[i].alias[j]);
+            newCpuEvent->src = event->src;
+            newCpuEvent->arbWait = event->arbWait;
+            newCpuEvent->busTime = event->busTime;
+            respond(newCpuEvent);
+        }
+        outRequest.erase(outRequest.begin() + i, outRequest.begin()+ i + 1);
+        break;
+    }
+    return true;
 }
 
 void cache::handleBusOp(SST::Event *ev) {
     // printf("Cache received event from bus id %d\n", cacheId);
+    SnoopEvent *snoop = dynamic_cast<SnoopEvent*>(ev);
+    if (snoop) {
+        handleBusEvent(*snoop->msg);
+        delete snoop;
+        return;
+    }
+    // Anything else is the response to our own request
     CacheEvent *event = dynamic_cast<CacheEvent*>(ev);  
     // printf("Cache received event from bus id: %d pid: %d addr: %lx type: %d\n", cacheId, event->pid, event->addr, event->event_type);  
-    if (event->pid == cacheId) {
-        CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
-        handleOutRequest(fevent);
-        releaseBus(fevent);
+    CacheEvent *fevent = new CacheEvent(*event);
+    fevent->busTime = getCurrentSimTimeNano() - event->busTime;
+    if (handleOutRequest(fevent)) {
+        respond(fevent);
     } else {
-        handleBusEvent(event);
+        delete fevent;
     }
+    releaseBus(event);
     // printf("Cache responded event from bus id: %d pid: %d addr: %lx type: %d\n", cacheId, event->pid, event->addr, event->event_type);
-    // delete event;
+    delete event;
 }
 
-void cache::handleBusEvent(CacheEvent *event) {
-    CacheLine_t *line = lookupCache(event->addr);
-    CacheEvent *busResponse;
+void cache::handleBusEvent(const SnoopMsg_t& snoop) {
+    CacheLine_t *line = lookupCache(snoop.addr);
+    EVENT_TYPE snoopResponse;
     if (line) {
-        // printf("Bus event hit in cache %d %lx %d\n", cacheId, event->addr, event->event_type);
-        switch (event->event_type) {
+        // printf("Bus event hit in cache %d %lx %d\n", cacheId, snoop.addr, snoop.event_type);
+        // A modified copy supplies the data, a clean one only reports that it is shared
+        snoopResponse = line->state == CacheState_t::M ? EVENT_TYPE::FLUSH : EVENT_TYPE::SHARED;
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::STATE, snoop.transactionId, snoop.addr, snoop.event_type,
+            (uint8_t) line->state, (uint8_t) (snoop.event_type == EVENT_TYPE::BUS_RD ? CacheState_t::S : CacheState_t::I));
+        switch (snoop.event_type) {
             case EVENT_TYPE::BUS_RD:
                 // Update state
                 line->state = CacheState_t::S;
-
-                busResponse = new CacheEvent;
-                busResponse->event_type = EVENT_TYPE::SHARED;
-                busResponse->addr = event->addr;
-                busResponse->pid = cacheId;
-                busResponse->transactionId = event->transactionId;
-                busResponse->cacheLineIdx = event->cacheLineIdx;
                 break;
             case EVENT_TYPE::BUS_RDX:
-                ninvalidations->addData(1);
-                // Update state
-                line->state = CacheState_t::I;
-                line->valid = false;
-
-                busResponse = new CacheEvent;
-                busResponse->event_type = EVENT_TYPE::SHARED;
-                busResponse->addr = event->addr;
-                busResponse->pid = cacheId;
-                busResponse->transactionId = event->transactionId;
-                busResponse->cacheLineIdx = event->cacheLineIdx;
-                break;
             case EVENT_TYPE::BUS_UPGR:
-                ninvalidations->addData(1);
+                ninvalidations++;
+                if (classifier)
+                    classifier->invalidate(snoop.addr, snoop.size, true);
+                if (profiler)
+                    profiler->invalidation(snoop.addr, snoop.pc);
                 // Update state
                 line->state = CacheState_t::I;
-                line->valid = false;    
-
-                busResponse = new CacheEvent;
-                busResponse->event_type = EVENT_TYPE::SHARED;
-                busResponse->addr = event->addr;
-                busResponse->pid = cacheId;
-                busResponse->transactionId = event->transactionId;
-                busResponse->cacheLineIdx = event->cacheLineIdx;
+                line->valid = false;
                 break;
             default:
                 out->fatal(CALL_INFO, -1, "Error! Invalid coherency protocol event\n");
         }
     } else {
-        // printf("Bus event miss in cache %d %lx\n", cacheId, event->addr);
-        busResponse = new CacheEvent;
-        busResponse->event_type = EVENT_TYPE::EMPTY;
-        busResponse->addr = event->addr;
-        busResponse->pid = cacheId;
-        busResponse->transactionId = event->transactionId;
-        busResponse->cacheLineIdx = event->cacheLineIdx;
+        // printf("Bus event miss in cache %d %lx\n", cacheId, snoop.addr);
+        if (classifier && snoop.event_type != EVENT_TYPE::BUS_RD)
+            classifier->invalidate(snoop.addr, snoop.size, false);
+        snoopResponse = EVENT_TYPE::EMPTY;
     }
-    // printf("Sending bus response %d %lx %lu %lu\n", cacheId, busResponse->addr, busResponse->event_type, busResponse->pid);
-    buslink->send(busResponse);
-    // printf("Sent bus response %d %lx %lu %lu\n", cacheId, busResponse->addr, busResponse->event_type, busResponse->pid);
+    // printf("Sending bus response %d %lx %lu\n", cacheId, snoop.addr, snoopResponse);
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::SNOOP, snoop.transactionId, snoop.addr, snoop.event_type,
+        (uint8_t) snoopResponse, 0, snoop.pid);
+    buslink->send(new SnoopRespEvent(snoopResponse, cacheId, snoop.busTag));
 }
 
 void cache::handleArbOp(SST::Event *ev) {
@@ -293,9 +538,27 @@ void cache::handleArbOp(SST::Event *ev) {
     ArbEvent *event = dynamic_cast<ArbEvent*>(ev);  
     delete event;
     // printf("Cache received arb event %lu %d\n", cacheId, requestQueue.size());
-    CacheEvent *eventToBus = new CacheEvent(requestQueue[0].event_type, requestQueue[0].addr, requestQueue[0].pid,
-    requestQueue[0].transactionId, requestQueue[0].cacheLineIdx);
+    sendToBus();
+}
+
+void cache::sendToBus() {
+    // arbWait holds the time of the acquire request until the grant arrives, busTime the grant time
+    // until the bus responds
+    // An upgrade whose copy was invalidated while it waited for the grant has to fetch the line
+    if (requestQueue[0].event_type == EVENT_TYPE::BUS_UPGR && lookupCache(requestQueue[0].addr) == nullptr) {
+        upgradeConversions++;
+        requestQueue[0].event_type = EVENT_TYPE::BUS_RDX;
+        for (size_t i = 0; i < outRequest.size(); i++) {
+            if (outRequest[i].event.event_type == EVENT_TYPE::BUS_UPGR && outRequest[i].event.addr == requestQueue[0].addr)
+                outRequest[i].event.event_type = EVENT_TYPE::BUS_RDX;
+        }
+    }
+    CacheEvent *eventToBus = new CacheEvent(requestQueue[0]);
+    eventToBus->arbWait = getCurrentSimTimeNano() - requestQueue[0].arbWait;
+    eventToBus->busTime = getCurrentSimTimeNano();
     requestQueue.erase(requestQueue.begin(), requestQueue.begin() + 1);
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_REQ, eventToBus->transactionId, eventToBus->addr,
+        eventToBus->event_type);
     // printf("Cache send bus event %lu %d %lx %d\n", cacheId, requestQueue.size(), eventToBus->addr, eventToBus->event_type);
     buslink->send(eventToBus);
     // printf("Cache sent bus event %lu %d %lx %d\n", cacheId, requestQueue.size(), eventToBus->addr, eventToBus->event_type);
@@ -370,12 +633,12 @@ void cache::handleReadHitMsi(CacheEvent* event, CacheLine_t* line) {
         line->timestamp = timestamp; // Do nothing since line is in modified state
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
+        respond(fevent);
     } else if (line->state == CacheState_t::S) {
         line->timestamp = timestamp; // Do nothing since line is in shared state
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
+        respond(fevent);
     } else if (line->state == CacheState_t::I) {
         // This state is not possible in a read hit
         out->fatal(CALL_INFO, -1, "Error! Invalid cache state %s!\n", getName().c_str()); 
@@ -392,6 +655,8 @@ void cache::handleReadMissMsi(CacheEvent* event) {
     nextBusEvent->pid = event->pid;
     nextBusEvent->transactionId = event->transactionId;
     nextBusEvent->cacheLineIdx = event->addr / blockSize;
+    nextBusEvent->pc = event->pc;
+    nextBusEvent->size = event->size;
 
     // Evict the line later when the response is received
 
@@ -419,7 +684,7 @@ void cache::handleWriteHitMsi(CacheEvent* event, CacheLine_t* line) {
         line->timestamp = timestamp;
         line->dirty = true;
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent); // Do nothing since line is in modified state
+        respond(fevent); // Do nothing since line is in modified state
     } else if (line->state == CacheState_t::S) {
         nextBusEvent = new CacheEvent; // Have to issue a BusUpgr
         nextBusEvent->event_type = EVENT_TYPE::BUS_UPGR;
@@ -427,15 +692,12 @@ void cache::handleWriteHitMsi(CacheEvent* event, CacheLine_t* line) {
         nextBusEvent->pid = event->pid;
         nextBusEvent->transactionId = event->transactionId;
         nextBusEvent->cacheLineIdx = event->addr / blockSize;
+        nextBusEvent->pc = event->pc;
+        nextBusEvent->size = event->size;
 
-        // Update cache line attributes
-        line->state = CacheState_t::M;
-        line->dirty = true;
+        // The line turns M only once the bus has ordered the upgrade, a remote write may still take it first
         line->timestamp = timestamp;
-
-        // Build the arbiter event and request for bus
-        requestQueue.push_back(*nextBusEvent);
-        acquireBus(nextBusEvent);
+        upgradeLine(nextBusEvent);
         delete nextBusEvent;
     } else if (line->state == CacheState_t::I) {
         // This state is not possible in a read hit
@@ -452,13 +714,15 @@ void cache::handleWriteMissMsi(CacheEvent* event) {
     nextBusEvent->pid = event->pid;
     nextBusEvent->transactionId = event->transactionId;
     nextBusEvent->cacheLineIdx = event->addr / blockSize;
+    nextBusEvent->pc = event->pc;
+    nextBusEvent->size = event->size;
 
     // Evict the line later after the response is received
 
     // Build the arbiter event and request for bus
     for (int i = outRequest.size() - 1; i >= 0; i--) {
         if (outRequest[i].event.cacheLineIdx == nextBusEvent->cacheLineIdx) {
-            if (outRequest[i].event.event_type == EVENT_TYPE::BUS_RDX) {
+            if (outRequest[i].event.event_type != EVENT_TYPE::BUS_RD) {
                 outRequest[i].alias.push_back(*nextBusEvent);
                 return;
             } else {
@@ -486,17 +750,17 @@ void cache::handleReadHitMesi(CacheEvent* event, CacheLine_t* line) {
         line->timestamp = timestamp; // Do nothing since line is in modified state
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
+        respond(fevent);
     } else if (line->state == CacheState_t::S) {
         line->timestamp = timestamp; // Do nothing since line is in shared state
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
+        respond(fevent);
     } else if (line->state == CacheState_t::E) {
         line->timestamp = timestamp; // Do nothing since line is in shared state
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent);
+        respond(fevent);
     } else if (line->state == CacheState_t::I) {
         // This state is not possible in a read hit
         out->fatal(CALL_INFO, -1, "Error! Invalid cache state %s!\n", getName().c_str()); 
@@ -513,6 +777,8 @@ void cache::handleReadMissMesi(CacheEvent* event) {
     nextBusEvent->pid = event->pid;
     nextBusEvent->transactionId = event->transactionId;
     nextBusEvent->cacheLineIdx = event->addr / blockSize;
+    nextBusEvent->pc = event->pc;
+    nextBusEvent->size = event->size;
 
     // Evict the line later when the response is received
 
@@ -540,14 +806,16 @@ void cache::handleWriteHitMesi(CacheEvent* event, CacheLine_t* line) {
         line->dirty = true;
         line->timestamp = timestamp;
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent); // Do nothing since line is in modified state
+        respond(fevent); // Do nothing since line is in modified state
     } else if (line->state == CacheState_t::E) {
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::STATE, event->transactionId, event->addr,
+            event->event_type, (uint8_t) CacheState_t::E, (uint8_t) CacheState_t::M);
         line->state = CacheState_t::M;
         line->dirty = true;
         line->timestamp = timestamp;
 
         CacheEvent *fevent = new CacheEvent(event->event_type, event->addr, event->pid, event->transactionId, event->cacheLineIdx);
-        cpulink->send(fevent); // Do nothing since line is in modified state
+        respond(fevent); // Do nothing since line is in modified state
     } else if (line->state == CacheState_t::S) {
         nextBusEvent = new CacheEvent; // Have to issue a BusUpgr
         nextBusEvent->event_type = EVENT_TYPE::BUS_UPGR;
@@ -555,15 +823,12 @@ void cache::handleWriteHitMesi(CacheEvent* event, CacheLine_t* line) {
         nextBusEvent->pid = event->pid;
         nextBusEvent->transactionId = event->transactionId;
         nextBusEvent->cacheLineIdx = event->addr / blockSize;
+        nextBusEvent->pc = event->pc;
+        nextBusEvent->size = event->size;
 
-        // Update cache line attributes
-        line->state = CacheState_t::M;
-        line->dirty = true;
+        // The line turns M only once the bus has ordered the upgrade, a remote write may still take it first
         line->timestamp = timestamp;
-
-        // Build the arbiter event and request for bus
-        requestQueue.push_back(*nextBusEvent);
-        acquireBus(nextBusEvent);
+        upgradeLine(nextBusEvent);
         delete nextBusEvent;
     } else if (line->state == CacheState_t::I) {
         // This state is not possible in a read hit
@@ -580,13 +845,15 @@ void cache::handleWriteMissMesi(CacheEvent* event) {
     nextBusEvent->pid = event->pid;
     nextBusEvent->transactionId = event->transactionId;
     nextBusEvent->cacheLineIdx = event->addr / blockSize;
+    nextBusEvent->pc = event->pc;
+    nextBusEvent->size = event->size;
 
     // Evict the line later after the response is received
 
     // Build the arbiter event and request for bus
     for (int i = outRequest.size() - 1; i >= 0; i--) {
         if (outRequest[i].event.cacheLineIdx == nextBusEvent->cacheLineIdx) {
-            if (outRequest[i].event.event_type == EVENT_TYPE::BUS_RDX) {
+            if (outRequest[i].event.event_type != EVENT_TYPE::BUS_RD) {
                 outRequest[i].alias.push_back(*nextBusEvent);
                 return;
             } else {
@@ -610,31 +877,21 @@ void cache::handleWriteMissMesi(CacheEvent* event) {
  */
 
 CacheLine_t& cache::evictLineRr(CacheEvent* event) {
-    size_t idx = 0;
-    if (nsbits >= 1) {   
-        idx =  (event->addr >> nbbits) & ( 1 << (nsbits - 1));
-    } else {
-        idx = 0;
-    }
+    size_t idx = getSetIndex(event->addr);
     std::vector<CacheLine_t>& cacheSet = cacheLines[idx];
 	for (size_t i = 0; i < associativity; i++) {
         if (cacheSet[i].valid == false) {
             return cacheSet[i];
         }
     }
-	nevictions->addData(1);
+	nevictions++;
     size_t lineIdx = rrCounter[idx];
     lineIdx = (lineIdx + 1) % associativity;
     return cacheSet[lineIdx];
 }
 
 CacheLine_t& cache::evictLineLru(CacheEvent* event) {
-    size_t idx = 0;
-    if (nsbits >= 1) {   
-        idx =  (event->addr >> nbbits) & ( 1 << (nsbits - 1));
-    } else {
-        idx = 0;
-    }
+    size_t idx = getSetIndex(event->addr);
     std::vector<CacheLine_t>& cacheSet = cacheLines[idx];
     for (size_t i = 0; i < associativity; i++) {
         if (cacheSet[i].valid == false) {
@@ -644,7 +901,7 @@ CacheLine_t& cache::evictLineLru(CacheEvent* event) {
 
     size_t lineIdx = 0;
     size_t minTimestamp = timestamp + 1;
-	nevictions->addData(1);
+	nevictions++;
     for (size_t i = 0; i < associativity; i++) {
         if (cacheSet[i].valid == true and cacheSet[i].timestamp < minTimestamp) {
             lineIdx = i;
@@ -655,19 +912,14 @@ CacheLine_t& cache::evictLineLru(CacheEvent* event) {
 }
 
 CacheLine_t& cache::evictLineMru(CacheEvent* event) {
-    size_t idx = 0;
-    if (nsbits >= 1) {   
-        idx =  (event->addr >> nbbits) & ( 1 << (nsbits - 1));
-    } else {
-        idx = 0;
-    }
+    size_t idx = getSetIndex(event->addr);
     std::vector<CacheLine_t>& cacheSet = cacheLines[idx];
     for (size_t i = 0; i < associativity; i++) {
         if (cacheSet[i].valid == false) {
             return cacheSet[i];
         }
     }
-	nevictions->addData(1);
+	nevictions++;
     size_t lineIdx = 0;
     size_t maxTimestamp = 0;
     for (size_t i = 0; i < associativity; i++) {
@@ -686,12 +938,7 @@ CacheLine_t& cache::evictLineMru(CacheEvent* event) {
  */
 
 CacheLine_t* cache::lookupCache(size_t addr) {
-    size_t idx = 0;
-    if (nsbits >= 1) {   
-        idx =  (addr >> nbbits) & ( 1 << (nsbits - 1));
-    } else {
-        idx = 0;
-    }
+    size_t idx = getSetIndex(addr);
     std::vector<CacheLine_t>& cacheSet = cacheLines[idx];
     for (size_t i = 0; i < associativity; i++) {
         size_t tag = (cacheSet[i].address >> nbbits);
@@ -704,6 +951,25 @@ CacheLine_t* cache::lookupCache(size_t addr) {
 }
 
 
+size_t cache::getSetIndex(size_t addr) {
+    return (addr >> nbbits) & (nsets - 1);
+}
+
+void cache::classifyMiss(CacheEvent* event) {
+    // Misses merged into an outstanding request for the same line are not new misses
+    size_t lineIdx = event->addr / blockSize;
+    for (size_t i = 0; i < outRequest.size(); i++) {
+        if (outRequest[i].event.cacheLineIdx == lineIdx) {
+            mergedMisses++;
+            classifier->access(event->addr);
+            return;
+        }
+    }
+    MissClass_t mclass = classifier->classify(event->addr, event->size, event->pc);
+    nmissClass[(int) mclass]++;
+    classifier->access(event->addr);
+}
+
 void cache::parseParams(Params& params) {
     bool found;
     blockSize = params.find<size_t>("blockSize", 64, found);
@@ -735,6 +1001,7 @@ void cache::parseParams(Params& params) {
             out->fatal(CALL_INFO, -1, "Error! Invalid cache coherence protocol %s!\n", getName().c_str());
     }
     cacheId = params.find<size_t>("cacheId", 0, found);
+    configId = params.find<size_t>("configId", 0, found);
 }
 
 size_t cache::logFunc(size_t num) {
@@ -748,6 +1015,15 @@ size_t cache::logFunc(size_t num) {
 }
 
 void cache::acquireBus(CacheEvent* event) {
+    // Stamp the request just queued for the bus so the arbiter wait can be measured at grant
+    requestQueue.back().arbWait = getCurrentSimTimeNano();
+
+    // The bus arbitrates itself and fills in arbWait when it grants the request
+    if (integratedArbiter) {
+        sendToBus();
+        return;
+    }
+
     // Build the arbiter event and request for bus
     // printf("Building arb event. pid: %d\n", event->pid);
     nextArbEvent = new ArbEvent(ARB_EVENT_TYPE::AC, event->pid);
@@ -757,6 +1033,10 @@ void cache::acquireBus(CacheEvent* event) {
 }
 
 void cache::releaseBus(CacheEvent* event) {
+    // The bus releases the grant itself when it replies
+    if (integratedArbiter)
+        return;
+
     // Build the arbiter event and request for bus
     nextArbEvent = new ArbEvent;
     nextArbEvent->event_type = ARB_EVENT_TYPE::RL;
@@ -765,17 +1045,35 @@ void cache::releaseBus(CacheEvent* event) {
 }
 
 CacheLine_t& cache::evictLine(CacheEvent* event) {
+    CacheLine_t* victim = nullptr;
     switch(rpolicy) {
         case ReplacementPolicy_t::RR:
-            return evictLineRr(event);
+            victim = &evictLineRr(event);
             break;
         case ReplacementPolicy_t::LRU:
-            return evictLineLru(event);
+            victim = &evictLineLru(event);
             break;
         case ReplacementPolicy_t::MRU:
-            return evictLineMru(event);
+            victim = &evictLineMru(event);
             break;
         default:
             out->fatal(CALL_INFO, -1, "Error! Invalid replacement policy %s!\n", getName().c_str());
     }
+    bool dirtyVictim = writebackDirty && victim->valid && victim->dirty && (victim->address >> nbbits) != (event->addr >> nbbits);
+    if (victim->valid) {
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::EVICT, event->transactionId, victim->address,
+            event->event_type, (uint8_t) victim->state, dirtyVictim);
+    }
+    if (dirtyVictim) {
+        writeback(*victim);
+    }
+    return *victim;
+}
+
+// A posted write, it does not arbitrate for the bus and gets no response
+void cache::writeback(CacheLine_t& line) {
+    CacheEvent* wbEvent = new CacheEvent(EVENT_TYPE::BUS_WB, line.address, cacheId, 0);
+    buslink->send(wbEvent);
+    line.dirty = false;
+    nwritebacks++;
 }
\ No newline at end of file
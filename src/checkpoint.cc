@@ -0,0 +1,67 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "./include/checkpoint.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+static const char CHECKPOINT_MAGIC[8] = {'X', 'T', 'S', 'I', 'M', 'C', 'K', '1'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+void Checkpoint::expect(Serializer_t& ser, SST::Output* out, const std::string& name, const char* what, size_t value) {
+    size_t saved = value;
+    ser & saved;
+    if (saved != value)
+        out->fatal(CALL_INFO, -1, "Error! %s was checkpointed with %s %zu but is configured with %zu\n", name.c_str(), what, saved, value);
+}
+
+void Checkpoint::write(SST::Output* out, const std::string& path, const std::vector<char>& buffer) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        out->fatal(CALL_INFO, -1, "Error! cannot create checkpoint %s\n", path.c_str());
+    uint64_t length = buffer.size();
+    fwrite(CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC), file);
+    fwrite(&CHECKPOINT_VERSION, sizeof(CHECKPOINT_VERSION), 1, file);
+    fwrite(&length, sizeof(length), 1, file);
+    bool ok = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (fclose(file) != 0 || !ok)
+        out->fatal(CALL_INFO, -1, "Error! cannot write checkpoint %s\n", path.c_str());
+}
+
+std::vector<char> Checkpoint::read(SST::Output* out, const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        out->fatal(CALL_INFO, -1, "Error! cannot open checkpoint %s\n", path.c_str());
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint32_t version = 0;
+    uint64_t length = 0;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+        fread(&version, sizeof(version), 1, file) != 1 || fread(&length, sizeof(length), 1, file) != 1)
+        out->fatal(CALL_INFO, -1, "Error! %s is not an xtsim checkpoint\n", path.c_str());
+    if (version != CHECKPOINT_VERSION)
+        out->fatal(CALL_INFO, -1, "Error! %s has checkpoint version %u, expected %u\n", path.c_str(), version, CHECKPOINT_VERSION);
+    std::vector<char> buffer(length);
+    if (fread(buffer.data(), 1, length, file) != length)
+        out->fatal(CALL_INFO, -1, "Error! %s is truncated\n", path.c_str());
+    fclose(file);
+    return buffer;
+}
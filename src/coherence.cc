@@ -0,0 +1,81 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/coherence.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+void CoherenceChecker::start(size_t line, pid_t pid, EVENT_TYPE type) {
+    // a reader may see its fill before the read retires, e.g. when the next read joins the same fill
+    if (type == EVENT_TYPE::BUS_RD)
+        lines[line].sharers.set(pid);
+}
+
+void CoherenceChecker::snoopResponse(size_t line, pid_t pid, pid_t requester, EVENT_TYPE rsp) {
+    nchecks++;
+    if (rsp == EVENT_TYPE::EMPTY)
+        return;
+    LineGrant_t& grant = lines[line];
+    if (!grant.sharers.test(pid)) {
+        out->fatal(CALL_INFO, -1, "Error! %s coherence violation: cache%d holds line %zx it was never given or that was invalidated (snoop of cache%d)\n",
+            name.c_str(), pid, line, requester);
+    }
+    if (rsp == EVENT_TYPE::FLUSH && grant.owner != pid) {
+        out->fatal(CALL_INFO, -1, "Error! %s coherence violation: cache%d holds line %zx modified while cache%d owns it (snoop of cache%d)\n",
+            name.c_str(), pid, line, grant.owner, requester);
+    }
+}
+
+void CoherenceChecker::complete(size_t line, pid_t pid, EVENT_TYPE type, EVENT_TYPE rsp) {
+    LineGrant_t& grant = lines[line];
+    if (type == EVENT_TYPE::BUS_RD) {
+        // an unshared fill may turn E and then silently M, any other read leaves no writer
+        grant.sharers.set(pid);
+        grant.owner = rsp == EVENT_TYPE::NOT_SHARED ? pid : -1;
+    } else {
+        // BUS_RDX and BUS_UPGR invalidated every other copy
+        grant.sharers.reset();
+        grant.sharers.set(pid);
+        grant.owner = pid;
+    }
+}
+
+void CoherenceChecker::writeback(size_t line, pid_t pid) {
+    auto it = lines.find(line);
+    if (it == lines.end())
+        return;
+    it->second.sharers.reset(pid);
+    if (it->second.owner == pid)
+        it->second.owner = -1;
+}
+
+void CoherenceChecker::checkpoint(Serializer_t& ser) {
+    Checkpoint::map(ser, lines, [](Serializer_t& ser, LineGrant_t& grant) {
+        for (size_t w = 0; w < MAX_BUS_AGENTS / 64; w++) {
+            uint64_t word = 0;
+            for (size_t b = 0; b < 64; b++)
+                word |= (uint64_t) grant.sharers[w * 64 + b] << b;
+            ser & word;
+            for (size_t b = 0; b < 64; b++)
+                grant.sharers[w * 64 + b] = word >> b & 1;
+        }
+        ser & grant.owner;
+    });
+}
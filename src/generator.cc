@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include "sst_config.h"
 #include "./include/generator.h"
+#include <algorithm>
 
 using namespace SST;
 using namespace SST::xtsim;
@@ -44,6 +45,7 @@ XTSimGenerator::XTSimGenerator(ComponentId_t id, Params &params) : Component(id)
     generatorID = params.find<size_t>("generatorID");
     traceFilePath = params.find<string>("traceFilePath");
 	maxOutstandingReq = params.find<size_t>("maxOutstandingReq");
+	numShadows = params.find<size_t>("numShadows", 0);
 
     // Tell the simulation not to end until we're ready
     registerAsPrimaryComponent();
@@ -51,11 +53,15 @@ XTSimGenerator::XTSimGenerator(ComponentId_t id, Params &params) : Component(id)
 
     // configure our link with a callback function that will be called whenever an event arrives
     // Callback function is optional, if not provided then component must poll the link
-    link = configureLink("processorPort", new Event::Handler<XTSimGenerator>(this, &XTSimGenerator::handleEvent));
+    links.resize(numShadows + 1);
+    for (size_t i = 0; i <= numShadows; ++i) {
+        string portName = i == 0 ? "processorPort" : "shadowPort_" + std::to_string(i - 1);
+        links[i] = configureLink(portName, new Event::Handler<XTSimGenerator, size_t>(this, &XTSimGenerator::handleEvent, i));
 
-    // Make sure we successfully configured the links
-    // Failure usually means the user didn't connect the port in the input file
-    sst_assert(link, CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+        // Make sure we successfully configured the links
+        // Failure usually means the user didn't connect the port in the input file
+        sst_assert(links[i], CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+    }
 
     // set our clock. The simulator will call 'clockTic' at a 1GHz frequency
     registerClock("1GHz", new Clock::Handler<XTSimGenerator>(this, &XTSimGenerator::clockTic));
@@ -64,9 +70,48 @@ XTSimGenerator::XTSimGenerator(ComponentId_t id, Params &params) : Component(id)
 
     // read all the events from file
 	readFromTrace();
+	size_t roiMode = params.find<size_t>("roiMode", 0);
+	if (roiMode != 0)
+		applyRoi(roiMode);
+
+	offset = vector<size_t>(numShadows + 1, 0);
+	receiveCount = vector<size_t>(numShadows + 1, 0);
+	latency = vector<LatencyStats_t>(numShadows + 1);
+
+	// a restored run starts where the warmup run ended, the accesses before count as completed
+	string checkpointIn = params.find<string>("checkpointIn", "");
+	if (!checkpointIn.empty())
+		Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+	checkpointOut = params.find<string>("checkpointOut", "");
+	size_t warmupAccesses = params.find<size_t>("warmupAccesses", 0);
+	if (warmupAccesses && offset[0] + warmupAccesses < eventList.size())
+		eventList.resize(offset[0] + warmupAccesses);
+	receiveCount = offset;
+	sendTime = vector<vector<uint64_t>>(numShadows + 1, vector<uint64_t>(eventList.size(), 0));
+	for (size_t port = 0; port <= numShadows; ++port)
+		std::fill(sendTime[port].begin(), sendTime[port].begin() + offset[port], REQ_COMPLETED);
+	lastSampled = receiveCount[0];
 
-	offset = 0;
-	receiveCount = 0;
+	// periodic time series of every port and the forward progress watchdog
+	string sampleInterval = params.find<string>("sampleInterval", "0");
+	reportProgress = params.find<bool>("reportProgress", false);
+	if (sampleInterval != "0") {
+		vector<TimeSeries::Column_t> columns;
+		for (size_t port = 0; port <= numShadows; ++port) {
+			string suffix = port == 0 ? "" : "Config" + std::to_string(port);
+			columns.push_back({"completed" + suffix, TimeSeries::RATE});
+			columns.push_back({"outstanding" + suffix, TimeSeries::LEVEL});
+		}
+		series.open(out, params.find<string>("timeSeriesPrefix", ""), getName(), columns);
+		registerClock(sampleInterval, new Clock::Handler<XTSimGenerator>(this, &XTSimGenerator::sampleTic), false);
+	}
+	string watchdogInterval = params.find<string>("watchdogInterval", "100us");
+	watchdogFatal = params.find<bool>("watchdogFatal", false);
+	watchdogCount = receiveCount;
+	stalled = vector<bool>(numShadows + 1, false);
+	stalledSince = vector<SimTime_t>(numShadows + 1, 0);
+	if (watchdogInterval != "0")
+		registerClock(watchdogInterval, new Clock::Handler<XTSimGenerator>(this, &XTSimGenerator::watchdogTic), false);
 }
 
 void XTSimGenerator::readFromTrace() {
@@ -75,60 +120,226 @@ void XTSimGenerator::readFromTrace() {
 	string leading = "threadId: " + std::to_string(generatorID + 1);
 	std::ifstream infile(traceFilePath);
     while (getline(infile, line)) {
+		// region of interest markers are shared by all threads, the first region counts
+		if (line.rfind("#roi begin", 0) == 0 && traceRoiBegin == NO_ROI)
+			traceRoiBegin = eventList.size();
+		if (line.rfind("#roi end", 0) == 0 && traceRoiBegin != NO_ROI && traceRoiEnd == NO_ROI)
+			traceRoiEnd = eventList.size();
+
 		// skip other processors' lines
 		if(line.rfind(leading, 0) == string::npos)
 			continue;
         
-		// get the addr
-		size_t addrS = line.rfind(' ');
-		string hexAddr = line.substr(addrS + 1);
+		// get the instruction address, "threadId: N, <pc>: R <addr>"
+		size_t pcS = line.find(", ");
+		size_t pcE = line.find(':', pcS);
+		size_t pc = 0;
+		if (pcS != string::npos && pcE != string::npos) {
+			std::stringstream pcss;
+			pcss << std::hex << line.substr(pcS + 2, pcE - pcS - 2);
+			pcss >> pc;
+		}
+
+		// get the addr and the access size, which older traces do not have, "...: R <addr> [<size>]"
+		std::istringstream rest(line.substr(line.rfind(':') + 1));
+		string kind, hexAddr;
+		uint32_t size = 0;
+		rest >> kind >> hexAddr >> size;
 		size_t addr;
 		std::stringstream ss;
 		ss << std::hex << hexAddr;
 		ss >> addr;
 		// if it's a read trace
-		if(line.find('R') != string::npos){
+		if(kind == "R"){
 			CacheEvent event(EVENT_TYPE::PR_RD, addr, generatorID, getNextTransactionID());
+			event.pc = pc;
+			event.size = size;
 			eventList.push_back(event);
 		}else{ // a write trace
 			CacheEvent event(EVENT_TYPE::PR_WR, addr, generatorID, getNextTransactionID());
+			event.pc = pc;
+			event.size = size;
 			eventList.push_back(event);
 		}
 		// printf("[readFromTrace] one event added\n");
     }
 }
 
+void XTSimGenerator::applyRoi(size_t roiMode) {
+	if (roiMode > 2)
+		out->fatal(CALL_INFO, -1, "Error! %s: unknown roiMode %zu\n", getName().c_str(), roiMode);
+	if (traceRoiBegin == NO_ROI) {
+		out->output("%s: %s has no region of interest markers, the whole trace is simulated\n",
+			getName().c_str(), traceFilePath.c_str());
+		return;
+	}
+	size_t before = traceRoiBegin;
+	size_t after = traceRoiEnd == NO_ROI ? 0 : eventList.size() - traceRoiEnd;
+	if (traceRoiEnd != NO_ROI)
+		eventList.resize(traceRoiEnd);
+	if (roiMode == 1) {
+		// only the region is simulated, renumber it so transaction ids stay eventList indices
+		eventList.erase(eventList.begin(), eventList.begin() + traceRoiBegin);
+		for (size_t i = 0; i < eventList.size(); ++i)
+			eventList[i].transactionId = generatorID * MAX_EVENT_NUM + i;
+	} else {
+		// the caches reset their statistics when the first access of the region reaches them
+		roiStart = traceRoiBegin;
+		if (roiStart < eventList.size())
+			eventList[roiStart].roiBegin = true;
+	}
+	printf("[roi]: generator%zu %zu accesses in the region of interest, %zu before it %s, %zu after it skipped\n",
+		generatorID, eventList.size() - roiStart, before, roiMode == 1 ? "skipped" : "simulated as warmup", after);
+}
+
 // the end of instruction's lifecycle
-void XTSimGenerator::handleEvent(SST::Event* ev){
-	receiveCount++;
+void XTSimGenerator::handleEvent(SST::Event* ev, size_t port){
+	receiveCount[port]++;
 	CacheEvent* cacheEvent = dynamic_cast<CacheEvent*>(ev);
+	recordLatency(port, cacheEvent);
 	delete cacheEvent;
-    if (receiveCount == eventList.size()) {
-		stat_inst_cnt->addData(offset);
-        // Tell SST that it's OK to end the simulation (once all primary components agree, simulation will end)
-		// printf("Generator %d exiting\n", generatorID);
-        primaryComponentOKToEndSim(); 
+    if (receiveCount[port] == eventList.size()) {
+		if (port == 0)
+			stat_inst_cnt->addData(offset[port]);
+		// the simulation may only end once every configuration has drained the trace
+		if (++portsDone == links.size()) {
+			// Tell SST that it's OK to end the simulation (once all primary components agree, simulation will end)
+			// printf("Generator %d exiting\n", generatorID);
+			primaryComponentOKToEndSim(); 
+		}
 		return;
     }
+	if (offset[port] == eventList.size())
+		return;
 	// printf("generator received event with addr: %llx\n", cacheEvent->addr);
     size_t nstime = getCurrentSimTimeNano();
 	size_t ustime = getCurrentSimTimeMicro();
 	size_t mstime = getCurrentSimTimeMilli();
 	// printf("now sending new event proc %lu at time %lu:%lu:%lu\n", generatorID, mstime, ustime,nstime);
-	sendEvent();
+	sendEvent(port);
 }
 
-void XTSimGenerator::sendEvent(){
+void XTSimGenerator::sendEvent(size_t port){
 	// printf("ready to send event. offset:%zu\n", offset);
 	CacheEvent* ev = new CacheEvent;
     // printf("Addr %zx Type %d\n", eventList[offset].addr, eventList[offset].event_type);
-	ev->addr = eventList[offset].addr;
-	ev->event_type = eventList[offset].event_type;
-	ev->pid = eventList[offset].pid;
-	ev->transactionId = eventList[offset].transactionId;
+	ev->addr = eventList[offset[port]].addr;
+	ev->event_type = eventList[offset[port]].event_type;
+	ev->pid = eventList[offset[port]].pid;
+	ev->transactionId = eventList[offset[port]].transactionId;
+	ev->pc = eventList[offset[port]].pc;
+	ev->size = eventList[offset[port]].size;
+	ev->roiBegin = eventList[offset[port]].roiBegin;
 	// printf("sending %lu proc %zu\n", offset, generatorID);
-	link->send(ev);
-	offset++;
+	sendTime[port][offset[port]] = getCurrentSimTimeNano();
+	links[port]->send(ev);
+	offset[port]++;
+}
+
+void XTSimGenerator::recordLatency(size_t port, CacheEvent* ev){
+	size_t idx = ev->transactionId - generatorID * MAX_EVENT_NUM;
+	if (idx < roiStart) {
+		sendTime[port][idx] = REQ_COMPLETED;
+		return;
+	}
+	uint64_t total = getCurrentSimTimeNano() - sendTime[port][idx];
+	int isWrite = ev->event_type == EVENT_TYPE::PR_WR ? 1 : 0;
+	LatencyStats_t& stats = latency[port];
+	stats.total[isWrite][(int) ev->src].add(total);
+	sendTime[port][idx] = REQ_COMPLETED;
+	if (ev->src != DATA_SRC::HIT) {
+		// whatever is not arbiter wait or bus time was spent in the caches and links. A miss merged
+		// into an outstanding one joined it late, it only waited for the tail of its bus time and arbiter wait
+		uint64_t busTime = std::min<uint64_t>(ev->busTime, total);
+		uint64_t arbWait = std::min<uint64_t>(ev->arbWait, total - busTime);
+		stats.cachePhase.add(total - busTime - arbWait);
+		stats.arbiterPhase.add(arbWait);
+		stats.busPhase.add(busTime);
+	}
+}
+
+bool XTSimGenerator::sampleTic(Cycle_t cycle){
+	SimTime_t now = getCurrentSimTimeNano();
+	vector<uint64_t> values;
+	for (size_t port = 0; port < links.size(); ++port) {
+		values.push_back(receiveCount[port]);
+		values.push_back(offset[port] - receiveCount[port]);
+	}
+	series.sample(now, values);
+
+	if (reportProgress) {
+		double wall = series.wallSeconds();
+		size_t completed = receiveCount[0] - lastSampled;
+		double simSeconds = (now - lastSampleNs) * 1e-9;
+		double wallSeconds = wall - lastSampleWall;
+		printf("[progress]: generator%zu %zu/%zu accesses (%.1f%%) at %lu ns, %.0f accesses/s simulated, %.0f accesses/s wall, %zu outstanding\n",
+			generatorID, receiveCount[0], eventList.size(), eventList.empty() ? 100.0 : (double) receiveCount[0] / eventList.size() * 100.0,
+			now, simSeconds > 0 ? completed / simSeconds : 0.0, wallSeconds > 0 ? completed / wallSeconds : 0.0,
+			offset[0] - receiveCount[0]);
+		lastSampled = receiveCount[0];
+		lastSampleNs = now;
+		lastSampleWall = wall;
+	}
+	// the sample after the last response closes the series
+	return portsDone == links.size();
+}
+
+bool XTSimGenerator::watchdogTic(Cycle_t cycle){
+	SimTime_t now = getCurrentSimTimeNano();
+	for (size_t port = 0; port < links.size(); ++port) {
+		if (receiveCount[port] != watchdogCount[port]) {
+			if (stalled[port]) {
+				printf("[watchdog]: config%zu generator%zu resumed after %lu ns without progress\n",
+					port, generatorID, now - stalledSince[port]);
+				stalled[port] = false;
+			}
+			watchdogCount[port] = receiveCount[port];
+		} else if (offset[port] > receiveCount[port] && !stalled[port]) {
+			stalled[port] = true;
+			stalledSince[port] = lastCheckNs;
+			reportStall(port, now);
+		}
+	}
+	lastCheckNs = now;
+	return portsDone == links.size();
+}
+
+void XTSimGenerator::reportStall(size_t port, SimTime_t now){
+	// requests return in any order, the first one not completed is the oldest still outstanding
+	size_t oldest = 0;
+	while (oldest < offset[port] && sendTime[port][oldest] == REQ_COMPLETED)
+		oldest++;
+	const CacheEvent& ev = eventList[oldest];
+	if (watchdogFatal) {
+		out->fatal(CALL_INFO, -1, "Error! %s config%zu made no progress since %lu ns: %zu requests outstanding, oldest transaction %zu (%s %zx) sent at %lu ns\n",
+			getName().c_str(), port, lastCheckNs, offset[port] - receiveCount[port], ev.transactionId,
+			ev.event_type == EVENT_TYPE::PR_WR ? "write" : "read", ev.addr, sendTime[port][oldest]);
+	}
+	printf("[watchdog]: config%zu generator%zu no progress since %lu ns (now %lu ns): %zu requests outstanding, oldest transaction %zu (%s %zx) sent at %lu ns\n",
+		port, generatorID, lastCheckNs, now, offset[port] - receiveCount[port], ev.transactionId,
+		ev.event_type == EVENT_TYPE::PR_WR ? "write" : "read", ev.addr, sendTime[port][oldest]);
+}
+
+void XTSimGenerator::warmState(Serializer_t& ser){
+	Checkpoint::expect(ser, out, getName(), "generatorID", generatorID);
+	Checkpoint::expect(ser, out, getName(), "ports", links.size());
+	ser & offset;
+	for (size_t port = 0; port < offset.size(); ++port) {
+		if (offset[port] > eventList.size())
+			out->fatal(CALL_INFO, -1, "Error! %s was checkpointed after %zu accesses but %s has only %zu\n",
+				getName().c_str(), offset[port], traceFilePath.c_str(), eventList.size());
+	}
+}
+
+void XTSimGenerator::finish(){
+	if (checkpointOut.empty())
+		return;
+	for (size_t port = 0; port < links.size(); ++port) {
+		if (offset[port] != receiveCount[port])
+			out->output("%s: %zu requests of config%zu still outstanding are counted as done in the checkpoint\n",
+				getName().c_str(), offset[port] - receiveCount[port], port);
+	}
+	Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
 }
 
 /*
@@ -140,8 +351,13 @@ bool XTSimGenerator::clockTic( Cycle_t cycleCount)
 {
     if(!started){
 		started = true;
-		while(offset < maxOutstandingReq)
-			sendEvent();
+		for (size_t port = 0; port < links.size(); ++port) {
+			while(offset[port] - receiveCount[port] < maxOutstandingReq && offset[port] < eventList.size())
+				sendEvent(port);
+			// nothing left to send, e.g. restored at the end of the trace
+			if (receiveCount[port] == eventList.size() && ++portsDone == links.size())
+				primaryComponentOKToEndSim();
+		}
 	}
 	return true;
 }
@@ -151,5 +367,23 @@ bool XTSimGenerator::clockTic( Cycle_t cycleCount)
  */
 XTSimGenerator::~XTSimGenerator()
 {
+	const char* accessNames[2] = {"read", "write"};
+	const char* srcNames[4] = {"hit", "cache-to-cache", "memory", "llc"};
+	for (size_t port = 0; port < latency.size(); ++port) {
+		char prefix[64];
+		snprintf(prefix, sizeof(prefix), "[latency-stat]: config%zu generator%zu", port, generatorID);
+		for (int rw = 0; rw < 2; ++rw) {
+			for (int src = 0; src < 4; ++src) {
+				// only runs with a shared LLC have the fourth source
+				if (src == (int) DATA_SRC::LLC && latency[port].total[rw][src].getCount() == 0)
+					continue;
+				string label = string(accessNames[rw]) + " " + srcNames[src];
+				latency[port].total[rw][src].print(prefix, label.c_str());
+			}
+		}
+		latency[port].cachePhase.print(prefix, "miss cache phase");
+		latency[port].arbiterPhase.print(prefix, "miss arbiter wait");
+		latency[port].busPhase.print(prefix, "miss bus phase");
+	}
     delete out;
 }
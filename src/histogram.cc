@@ -0,0 +1,73 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/histogram.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+size_t LatencyHistogram::bucketOf(uint64_t value) {
+    const uint64_t subBuckets = 1ull << SUB_BITS;
+    if (value < subBuckets)
+        return value;
+    size_t exp = 63 - __builtin_clzll(value);
+    size_t shift = exp - SUB_BITS;
+    return (exp - SUB_BITS + 1) * subBuckets + ((value >> shift) - subBuckets);
+}
+
+uint64_t LatencyHistogram::bucketHigh(size_t bucket) {
+    const uint64_t subBuckets = 1ull << SUB_BITS;
+    if (bucket < subBuckets)
+        return bucket;
+    size_t exp = bucket / subBuckets + SUB_BITS - 1;
+    uint64_t mantissa = bucket % subBuckets + subBuckets;
+    size_t shift = exp - SUB_BITS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t value) {
+    size_t bucket = bucketOf(value);
+    if (bucket >= buckets.size())
+        buckets.resize(bucket + 1, 0);
+    buckets[bucket]++;
+    count++;
+    sum += value;
+    if (value > max)
+        max = value;
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (count == 0)
+        return 0;
+    uint64_t rank = (uint64_t) (p * count);
+    if (rank >= count)
+        rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen > rank)
+            return bucketHigh(i) < max ? bucketHigh(i) : max;
+    }
+    return max;
+}
+
+void LatencyHistogram::print(const char* prefix, const char* label) const {
+    printf("%s %s count: %lu mean: %.2f p50: %lu p99: %lu p99.9: %lu max: %lu\n", prefix, label,
+        count, getMean(), percentile(0.5), percentile(0.99), percentile(0.999), max);
+}
@@ -0,0 +1,135 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/hotspot.h"
+#include <algorithm>
+
+using namespace SST;
+using namespace SST::xtsim;
+
+HotspotTable::HotspotTable() {
+    entries.resize(1024, Entry_t{EMPTY_KEY, HotspotCount_t()});
+    shift = 64 - 10;
+}
+
+HotspotCount_t& HotspotTable::operator[](uint64_t key) {
+    size_t mask = entries.size() - 1;
+    size_t slot = slotOf(key);
+    while (entries[slot].key != key) {
+        if (entries[slot].key == EMPTY_KEY) {
+            if ((used + 1) * 4 > entries.size() * 3) {
+                grow();
+                return (*this)[key];
+            }
+            entries[slot].key = key;
+            used++;
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return entries[slot].count;
+}
+
+void HotspotTable::grow() {
+    std::vector<Entry_t> old(entries.size() * 2, Entry_t{EMPTY_KEY, HotspotCount_t()});
+    old.swap(entries);
+    shift--;
+    size_t mask = entries.size() - 1;
+    for (Entry_t& entry : old) {
+        if (entry.key == EMPTY_KEY)
+            continue;
+        size_t slot = slotOf(entry.key);
+        while (entries[slot].key != EMPTY_KEY)
+            slot = (slot + 1) & mask;
+        entries[slot] = entry;
+    }
+}
+
+std::vector<std::pair<uint64_t, HotspotCount_t>> HotspotTable::top(uint64_t HotspotCount_t::*field, size_t topN) const {
+    std::vector<std::pair<uint64_t, HotspotCount_t>> ranked;
+    for (const Entry_t& entry : entries) {
+        if (entry.key != EMPTY_KEY && entry.count.*field)
+            ranked.emplace_back(entry.key, entry.count);
+    }
+    size_t n = std::min(topN, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+        [field](const std::pair<uint64_t, HotspotCount_t>& a, const std::pair<uint64_t, HotspotCount_t>& b) {
+            return a.second.*field > b.second.*field;
+        });
+    ranked.resize(n);
+    return ranked;
+}
+
+void HotspotProfiler::miss(size_t addr, size_t pc) {
+    totalMisses++;
+    pcs[pc].misses++;
+    pages[addr / pageSize].misses++;
+    lines[addr / blockSize].misses++;
+}
+
+void HotspotProfiler::upgrade(size_t addr, size_t pc) {
+    totalUpgrades++;
+    pcs[pc].upgrades++;
+    pages[addr / pageSize].upgrades++;
+    lines[addr / blockSize].upgrades++;
+}
+
+void HotspotProfiler::invalidation(size_t addr, size_t remotePc) {
+    totalInvalidations++;
+    pcs[remotePc].invalidations++;
+    pages[addr / pageSize].invalidations++;
+    lines[addr / blockSize].invalidations++;
+}
+
+void HotspotProfiler::reset() {
+    pcs = HotspotTable();
+    pages = HotspotTable();
+    lines = HotspotTable();
+    totalMisses = 0;
+    totalUpgrades = 0;
+    totalInvalidations = 0;
+}
+
+void HotspotProfiler::reportTop(const char* prefix, const char* what, const HotspotTable& table,
+    uint64_t HotspotCount_t::*field, const char* fieldName, uint64_t total, size_t scale, size_t topN) {
+    if (total == 0)
+        return;
+    printf("%s top %lu %ss by %s (%lu in total over %lu %ss):\n", prefix, topN, what, fieldName, total, table.size(), what);
+    // a PC is charged with the invalidations it caused remotely, a page or line with the ones it suffered here
+    const char* invalidationName = &table == &pcs ? "invalidations caused" : "invalidations";
+    for (auto& ranked : table.top(field, topN)) {
+        const HotspotCount_t& count = ranked.second;
+        printf("%s   %s 0x%lx %.1f%% misses: %lu upgrades: %lu %s: %lu\n", prefix, what, ranked.first * scale,
+            (double) (count.*field) / total * 100.0, count.misses, count.upgrades, invalidationName, count.invalidations);
+    }
+}
+
+void HotspotProfiler::report(size_t configId, size_t cacheId, size_t topN) {
+    if (topN == 0)
+        return;
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "[hotspot]: config%zu cache%zu", configId, cacheId);
+    reportTop(prefix, "pc", pcs, &HotspotCount_t::misses, "misses", totalMisses, 1, topN);
+    reportTop(prefix, "pc", pcs, &HotspotCount_t::invalidations, "invalidations caused", totalInvalidations, 1, topN);
+    reportTop(prefix, "pc", pcs, &HotspotCount_t::upgrades, "upgrades", totalUpgrades, 1, topN);
+    reportTop(prefix, "page", pages, &HotspotCount_t::misses, "misses", totalMisses, pageSize, topN);
+    reportTop(prefix, "page", pages, &HotspotCount_t::invalidations, "invalidations", totalInvalidations, pageSize, topN);
+    reportTop(prefix, "line", lines, &HotspotCount_t::misses, "misses", totalMisses, blockSize, topN);
+    reportTop(prefix, "line", lines, &HotspotCount_t::invalidations, "invalidations", totalInvalidations, blockSize, topN);
+}
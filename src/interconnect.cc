@@ -18,14 +18,11 @@
 #include "./include/interconnect.h"
 #include "sst_config.h"
 #include <stdio.h>
+#include <algorithm>
 
 using namespace SST;
 using namespace SST::xtsim;
 
-static size_t getPid(size_t tid) {
-    return tid >> 48;
-}
-
 /*
  * During construction the XTSimGenerator component should prepare for simulation
  * - Read parameters
@@ -49,72 +46,455 @@ XTSimBus::XTSimBus(ComponentId_t id, Params &params) : Component(id) {
     // Get parameter from the Python input
     // bool found;
     processorNum = params.find<size_t>("processorNum");
+    if (processorNum == 0 || processorNum > MAX_BUS_AGENTS) {
+        out->fatal(CALL_INFO, -1, "Error! %s supports 1 to %zu processors, got %zu\n", getName().c_str(), MAX_BUS_AGENTS, processorNum);
+    }
 	memoryAccessTime =  params.find<size_t>("memoryAccessTime", 100);
+	configId = params.find<size_t>("configId", 0);
     // maxBusTransactions = params.find<size_t>("maxBusTransactions");
 
     // configure our link with a callback function that will be called whenever an event arrives
     // Callback function is optional, if not provided then component must poll the link
     links.resize(processorNum);
-    for (int i = 0; i < processorNum; ++i) {
+    for (size_t i = 0; i < processorNum; ++i) {
         string portName = "busPort_" + std::to_string(i);
         links[i] = configureLink(portName, new Event::Handler<XTSimBus>(this, &XTSimBus::handleEvent));
         sst_assert(links[i], CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
     }
-    memLink = configureLink("memPort", new Event::Handler<XTSimBus>(this, &XTSimBus::handleMemEvent));
+
+    // misses are spread over the memory channels, optionally grouped into NUMA nodes
+    memChannels = params.find<size_t>("memChannels", 1);
+    size_t policy = params.find<size_t>("interleave", 0);
+    interleave = policy == 2 ? Interleave_t::XOR : (policy == 1 ? Interleave_t::PAGE : Interleave_t::LINE);
+    pageSize = params.find<size_t>("pageSize", 4096);
+    numaNodes = params.find<size_t>("numaNodes", 0);
+    numaPlacement = params.find<size_t>("numaPlacement", 0) == 1 ? NumaPlacement_t::FIRST_TOUCH : NumaPlacement_t::INTERLEAVE;
+    remoteLatency = params.find<SimTime_t>("remoteLatency", 50);
+    if (memChannels == 0 || pageSize == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs at least one memory channel and a non-zero pageSize\n", getName().c_str());
+    if (numaNodes && (memChannels % numaNodes != 0 || processorNum < numaNodes))
+        out->fatal(CALL_INFO, -1, "Error! %s needs memChannels and processorNum to cover all %zu NUMA nodes\n", getName().c_str(), numaNodes);
+    memLinks.resize(memChannels);
+    for (size_t i = 0; i < memChannels; ++i) {
+        string portName = memChannels == 1 ? "memPort" : "memPort_" + std::to_string(i);
+        memLinks[i] = configureLink(portName, new Event::Handler<XTSimBus>(this, &XTSimBus::handleMemEvent));
+        sst_assert(memLinks[i], CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+    }
+    channelStats.resize(memChannels);
+
+    // split-transaction timing runs the address and data phases through self links clocked by the bus
+    busModel = params.find<size_t>("busModel", 0) == 1 ? BusModel_t::SPLIT : BusModel_t::ATOMIC;
+    busTc = registerTimeBase(params.find<string>("busClock", "1GHz"), false);
+    size_t busWidth = params.find<size_t>("busWidth", 16);
+    blockSize = params.find<size_t>("blockSize", 64);
+    dataCycles = (blockSize + busWidth - 1) / busWidth;
+    pipelineDepth = params.find<size_t>("pipelineDepth", 4);
+    if (busModel == BusModel_t::SPLIT && (busWidth == 0 || pipelineDepth == 0))
+        out->fatal(CALL_INFO, -1, "Error! %s needs a non-zero busWidth and pipelineDepth\n", getName().c_str());
+    addrLink = configureSelfLink("addrPhase", busTc, new Event::Handler<XTSimBus>(this, &XTSimBus::handleAddrPhase));
+    dataLink = configureSelfLink("dataPhase", busTc, new Event::Handler<XTSimBus>(this, &XTSimBus::handleDataPhase));
+
+    // with integrated arbitration requests queue on their port until granted, the reply releases the grant
+    arbitration = nullptr;
+    if (params.find<bool>("integratedArbiter", false)) {
+        arbitration = new Arbitration(processorNum, Arbitration::readConfig(params, out, getName(), processorNum));
+        portQueues.resize(processorNum);
+    }
+    arbWakeupLink = configureSelfLink("arbWakeup", "1ns", new Event::Handler<XTSimBus>(this, &XTSimBus::handleArbWakeup));
+
+    checker = params.find<bool>("checkCoherence", false) ? new CoherenceChecker(out, getName()) : nullptr;
+
+    // the hot paths only bump local counters, they reach the statistics every statFlushPeriod and at finish
+    counters.add(totalTraffic, registerStatistic<uint64_t>("totalTraffic"));
+    counters.add(reqTraffic, registerStatistic<uint64_t>("reqTraffic"));
+    counters.add(respTraffic, registerStatistic<uint64_t>("respTraffic"));
+    counters.add(memoryTraffic, registerStatistic<uint64_t>("memoryTraffic"));
+    counters.add(writebackTraffic, registerStatistic<uint64_t>("writebackTraffic"));
+    counters.add(earlyReplies, registerStatistic<uint64_t>("earlyReplies"));
+    counters.add(coalescedFills, registerStatistic<uint64_t>("coalescedFills"));
+    counters.add(lineConflicts, registerStatistic<uint64_t>("lineConflicts"));
+    counters.add(conflictCycles, registerStatistic<uint64_t>("conflictCycles"), true);
+    counters.add(addrStats.transfers, registerStatistic<uint64_t>("addrTransfers"));
+    counters.add(addrStats.busyCycles, registerStatistic<uint64_t>("addrBusyCycles"), true);
+    counters.add(addrStats.waitCycles, registerStatistic<uint64_t>("addrWaitCycles"), true);
+    counters.add(dataStats.transfers, registerStatistic<uint64_t>("dataTransfers"));
+    counters.add(dataStats.busyCycles, registerStatistic<uint64_t>("dataBusyCycles"), true);
+    counters.add(dataStats.waitCycles, registerStatistic<uint64_t>("dataWaitCycles"), true);
+    for (size_t i = 0; i < memChannels; ++i) {
+        string channel = std::to_string(i);
+        counters.add(channelStats[i].reads, registerStatistic<uint64_t>("channelReads", channel));
+        counters.add(channelStats[i].writebacks, registerStatistic<uint64_t>("channelWritebacks", channel));
+        counters.add(channelStats[i].remote, registerStatistic<uint64_t>("channelRemote", channel));
+    }
+    for (size_t i = 0; arbitration && i < processorNum; ++i) {
+        string core = std::to_string(i);
+        ArbWaitStats_t& stats = arbitration->stats(i);
+        counters.add(stats.grants, registerStatistic<uint64_t>("grants", core));
+        counters.add(stats.waitSum, registerStatistic<uint64_t>("grantWait", core), true);
+        counters.add(stats.starved, registerStatistic<uint64_t>("starvedGrants", core));
+    }
+    string flushPeriod = params.find<string>("statFlushPeriod", "10us");
+    if (flushPeriod != "0")
+        registerClock(flushPeriod, new Clock::Handler<XTSimBus>(this, &XTSimBus::flushStats), false);
+    // with roiMode 2 the warmup traffic is never flushed, beginRoi releases the counters
+    if (params.find<size_t>("roiMode", 0) == 2)
+        counters.hold();
+    string sampleInterval = params.find<string>("sampleInterval", "0");
+    if (sampleInterval != "0") {
+        series.open(out, params.find<string>("timeSeriesPrefix", ""), getName(), {
+            {"inFlight", TimeSeries::LEVEL}, {"lineWaiting", TimeSeries::LEVEL}, {"memoryFills", TimeSeries::LEVEL},
+            {"arbQueued", TimeSeries::LEVEL}, {"reqTraffic", TimeSeries::DELTA}, {"memoryTraffic", TimeSeries::DELTA}});
+        registerClock(sampleInterval, new Clock::Handler<XTSimBus>(this, &XTSimBus::sampleTic), false);
+    }
+    trace.open(params, out, getName());
+
+    // snoop responses are folded into per-transaction slots with bitmask of responders
+    size_t nslots = params.find<size_t>("busSlots", 16);
+    slots.resize(nslots);
+    for (size_t i = nslots; i > 0; --i)
+        freeSlots.push_back(i - 1);
+
+    string checkpointIn = params.find<string>("checkpointIn", "");
+    if (!checkpointIn.empty())
+        Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    checkpointOut = params.find<string>("checkpointOut", "");
 }
 
 void XTSimBus::handleEvent(SST::Event *ev) {
     // printf("Bus received event\n");
+    CacheEvent *control = dynamic_cast<CacheEvent *>(ev);
+    if (control && control->event_type == EVENT_TYPE::ROI_BEGIN) {
+        beginRoi(control);
+        return;
+    }
 	totalTraffic++;
+    SnoopRespEvent *token = dynamic_cast<SnoopRespEvent *>(ev);
+    if (token) {
+		respTraffic ++;
+        handleSnoopResponse(token->pid, token->rsp, token->busTag);
+        delete token;
+        if (arbitration)
+            grantRequests();
+        return;
+    }
     CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
 
     // printf("bus received event with addr: %zx from processor_%d\n", cacheEvent->addr, cacheEvent->pid);
+    if (cacheEvent->event_type == EVENT_TYPE::BUS_WB) {
+        if (checker)
+            checker->writeback(cacheEvent->addr / blockSize, cacheEvent->pid);
+        writeback(cacheEvent);
+        return;
+    }
     if (processorNum == 1) {
 		reqTraffic ++;
-        sendEvent(cacheEvent->pid, cacheEvent);
+		totalTraffic ++;
+        cacheEvent->src = DATA_SRC::MEMORY;
+        links[cacheEvent->pid]->send(cacheEvent);
+        return;
+    }
+
+	reqTraffic ++;
+    if (arbitration) {
+        portQueues[cacheEvent->pid].push_back(*cacheEvent);
+        arbitration->request(cacheEvent->pid, getCurrentSimTimeNano());
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::ARB_REQ, cacheEvent->transactionId, cacheEvent->addr,
+            cacheEvent->event_type, 0, 0, cacheEvent->pid);
         delete cacheEvent;
+        grantRequests();
         return;
     }
+    startTransaction(cacheEvent);
+    delete cacheEvent;
+    // printf("reaching the end of bus handleEvent. addr: %zx from processor_%d\n", cacheEvent->addr, cacheEvent->pid);
+}
 
-    size_t tid = cacheEvent->transactionId;
-    if (!transactionsMap.count(tid)) {
-		reqTraffic ++;
-        transactionsMap[tid] = {*cacheEvent};
-        broadcast(cacheEvent->pid, cacheEvent);
+void XTSimBus::beginRoi(CacheEvent *ev) {
+    if (!roiStarted) {
+        roiStarted = true;
+        counters.reset();
+        series.rebase();
+        maxLineQueue = 0;
+        addrStats.maxWait = 0;
+        dataStats.maxWait = 0;
+        if (arbitration)
+            arbitration->resetStats();
+        roiCycle = getCurrentSimTime(busTc);
+        // the memories or LLC slices behind the channels reset with the bus
+        for (size_t i = 0; i < memLinks.size(); ++i)
+            memLinks[i]->send(new CacheEvent(*ev));
+    }
+    delete ev;
+}
+
+void XTSimBus::grantRequests() {
+    SimTime_t now = getCurrentSimTimeNano();
+    int pid;
+    while ((pid = arbitration->next(now)) >= 0) {
+        // the cache stamped its send time in busTime, the queueing here is arbiter wait
+        CacheEvent req = portQueues[pid].front();
+        portQueues[pid].pop_front();
+        req.arbWait = now - req.busTime;
+        req.busTime = now;
+        XTSIM_TRACE_RECORD(trace, now, TraceKind::ARB_GRANT, req.transactionId, req.addr, req.event_type, 0, 0, pid);
+        startTransaction(&req);
+    }
+    // nothing else wakes the arbitration when the waiting cores do not own the current TDM slot
+    SimTime_t retry = arbitration->retryAt(now);
+    if (retry && arbWakeupAt == 0) {
+        arbWakeupAt = retry;
+        arbWakeupLink->send(retry - now, new ArbEvent(ARB_EVENT_TYPE::AC, -1));
+    }
+}
+
+void XTSimBus::handleArbWakeup(SST::Event *ev) {
+    delete ev;
+    arbWakeupAt = 0;
+    grantRequests();
+}
+
+// new grants wait for the end of the handler, starting a transaction may grow the slot table
+void XTSimBus::complete(pid_t pid) {
+    if (arbitration && !arbitration->release(pid))
+        out->fatal(CALL_INFO, -1, "Error! %s: transaction of cache%d completed with no grant outstanding\n", getName().c_str(), pid);
+}
+
+void XTSimBus::startTransaction(CacheEvent *ev) {
+    uint32_t tag = allocSlot();
+    BusSlot_t& slot = slots[tag];
+    slot.req = *ev;
+    slot.req.busTag = tag;
+    slot.nresp = 0;
+    slot.sharedMask.reset();
+    slot.dirtyMask.reset();
+    slot.responded = false;
+    slot.delivered = false;
+    slot.memPending = false;
+    slot.arrival = getCurrentSimTime(busTc);
+    slot.snoop = std::make_shared<const SnoopMsg_t>(SnoopMsg_t{slot.req.event_type, slot.req.addr, slot.req.pid,
+        slot.req.transactionId, slot.req.cacheLineIdx, tag, slot.req.pc, slot.req.size});
+
+    // a transaction to a line another one is working on waits for it, so a BUS_RD never races a BUS_RDX
+    size_t line = slot.req.addr / blockSize;
+    LineQueue_t& queue = busyLines[line];
+    if (queue.active == 0) {
+        queue.active = 1;
+        launch(tag);
+    } else if (queue.waiting.empty() && joinFill(tag)) {
+        queue.active++;
     } else {
-		respTraffic ++;
-        transactionsMap[tid].push_back(*cacheEvent);
-        if (transactionsMap[tid].size() == processorNum) {
-            CacheEvent* reqEvent = new CacheEvent(transactionsMap[tid][0].event_type, transactionsMap[tid][0].addr, transactionsMap[tid][0].pid, 
-    transactionsMap[tid][0].transactionId, transactionsMap[tid][0].cacheLineIdx); // Entry zero is the request
-            if (reqEvent->event_type == EVENT_TYPE::BUS_UPGR) {
-                sendEvent(getPid(tid), reqEvent);
-				transactionsMap.erase(tid);
-            } else { // for BUS_RD and BUS_RDX, check if there is non-empty response from other caches
-                for (int i = 1; i < processorNum; ++i) {
-                    auto respEvent = transactionsMap[tid][i];
-                    if (respEvent.event_type != EVENT_TYPE::EMPTY) {
-                        reqEvent->rsp = EVENT_TYPE::SHARED;
-                        sendEvent(getPid(tid), reqEvent);
-						transactionsMap.erase(tid);
-                        delete cacheEvent;
-						return;
-                    }
-                }
-				// otherwise, read from memory
-                // printf("1 %p\n", reqEvent);
-                reqEvent->rsp = EVENT_TYPE::NOT_SHARED;
-				memLink->send(reqEvent);
-                // printf("2\n");
-				totalTraffic ++;
-				memoryTraffic ++;
-				// transactionsMap.erase(tid);
-                // printf("3\n");
+        XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_WAIT, slot.req.transactionId, slot.req.addr,
+            slot.req.event_type, 0, 0, tag);
+        queue.waiting.push_back(tag);
+        lineConflicts++;
+        maxLineQueue = std::max(maxLineQueue, queue.waiting.size());
+    }
+}
+
+void XTSimBus::launch(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    SimTime_t now = getCurrentSimTime(busTc);
+    conflictCycles += now - slot.arrival;
+    slot.arrival = now;
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_START, slot.req.transactionId, slot.req.addr,
+        slot.req.event_type, 0, 0, tag);
+    if (checker)
+        checker->start(slot.req.addr / blockSize, slot.req.pid, slot.req.event_type);
+    if (busModel == BusModel_t::ATOMIC) {
+        broadcast(tag);
+    } else if (snoopInFlight < pipelineDepth) {
+        issueAddrPhase(tag);
+    } else {
+        addrQueue.push_back(tag);
+    }
+}
+
+// The snoops of a read waiting on memory found no cached copy and nothing else has run on the line
+// since, so another read can share its fill without snooping
+bool XTSimBus::joinFill(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    size_t line = slot.req.addr / blockSize;
+    if (slot.req.event_type != EVENT_TYPE::BUS_RD || !busyLines[line].readFill)
+        return false;
+    slot.nresp = processorNum - 1;
+    slot.memPending = true;
+    pendingFills[line].push_back(tag);
+    coalescedFills++;
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_START, slot.req.transactionId, slot.req.addr,
+        slot.req.event_type, 1, 0, tag);
+    if (checker)
+        checker->start(line, slot.req.pid, slot.req.event_type);
+    return true;
+}
+
+// reads at the head of the line queue join a fill that just started
+void XTSimBus::coalesceWaiting(size_t line) {
+    LineQueue_t& queue = busyLines[line];
+    while (!queue.waiting.empty() && joinFill(queue.waiting.front())) {
+        conflictCycles += getCurrentSimTime(busTc) - slots[queue.waiting.front()].arrival;
+        queue.waiting.pop_front();
+        queue.active++;
+    }
+}
+
+void XTSimBus::tryRetire(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    if (slot.nresp != processorNum - 1 || slot.memPending || !slot.delivered)
+        return;
+    size_t line = slot.req.addr / blockSize;
+    if (checker)
+        checker->complete(line, slot.req.pid, slot.req.event_type, slot.req.rsp);
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_RETIRE, slot.req.transactionId, slot.req.addr,
+        slot.req.event_type, (uint8_t) slot.req.rsp, 0, tag);
+    freeSlot(tag);
+    releaseLine(line);
+}
+
+// the reply of the retired transaction already left on the requester's link, so the next
+// transaction's snoops reach it after the line
+void XTSimBus::releaseLine(size_t line) {
+    auto it = busyLines.find(line);
+    LineQueue_t& queue = it->second;
+    if (--queue.active > 0)
+        return;
+    if (queue.waiting.empty()) {
+        busyLines.erase(it);
+        return;
+    }
+    uint32_t tag = queue.waiting.front();
+    queue.waiting.pop_front();
+    queue.active = 1;
+    launch(tag);
+}
+
+// the address bus takes one request per cycle, the snoop then holds a pipeline stage until it resolves
+void XTSimBus::issueAddrPhase(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    SimTime_t now = getCurrentSimTime(busTc);
+    SimTime_t start = std::max(now, addrFree);
+    addrFree = start + 1;
+    snoopInFlight++;
+
+    SimTime_t wait = start - slot.arrival;
+    addrStats.transfers++;
+    addrStats.busyCycles++;
+    addrStats.waitCycles += wait;
+    addrStats.maxWait = std::max(addrStats.maxWait, wait);
+    addrLink->send(addrFree - now, new SnoopEvent(slot.snoop));
+}
+
+void XTSimBus::handleAddrPhase(SST::Event *ev) {
+    SnoopEvent *snoop = dynamic_cast<SnoopEvent *>(ev);
+    broadcast(snoop->msg->busTag);
+    delete snoop;
+}
+
+void XTSimBus::snoopDone() {
+    snoopInFlight--;
+    if (!addrQueue.empty()) {
+        uint32_t tag = addrQueue.front();
+        addrQueue.pop_front();
+        issueAddrPhase(tag);
+    }
+}
+
+// a cache block crosses the data bus in dataCycles once the bus is free
+void XTSimBus::transferData(CacheEvent *ev) {
+    SimTime_t now = getCurrentSimTime(busTc);
+    SimTime_t start = std::max(now, dataFree);
+    dataFree = start + dataCycles;
+
+    SimTime_t wait = start - now;
+    dataStats.transfers++;
+    dataStats.busyCycles += dataCycles;
+    dataStats.waitCycles += wait;
+    dataStats.maxWait = std::max(dataStats.maxWait, wait);
+    dataLink->send(dataFree - now, new CacheEvent(*ev));
+}
+
+void XTSimBus::handleDataPhase(SST::Event *ev) {
+    CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
+	totalTraffic ++;
+    pid_t pid = cacheEvent->pid;
+    uint32_t tag = cacheEvent->busTag;
+    links[pid]->send(cacheEvent);
+    complete(pid);
+    slots[tag].delivered = true;
+    tryRetire(tag);
+    if (arbitration)
+        grantRequests();
+}
+
+void XTSimBus::handleSnoopResponse(pid_t pid, EVENT_TYPE rsp, uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    slot.nresp++;
+    if (checker)
+        checker->snoopResponse(slot.req.addr / blockSize, pid, slot.req.pid, rsp);
+    if (rsp != EVENT_TYPE::EMPTY) {
+        slot.sharedMask.set(pid);
+        if (rsp == EVENT_TYPE::FLUSH)
+            slot.dirtyMask.set(pid);
+
+        // for BUS_RD and BUS_RDX the first cache holding the line supplies it, no need to wait for the rest
+        if (!slot.responded && slot.req.event_type != EVENT_TYPE::BUS_UPGR) {
+            if (slot.nresp != processorNum - 1)
+                earlyReplies++;
+            respond(slot, EVENT_TYPE::SHARED, DATA_SRC::CACHE);
+        }
+    }
+    if (slot.nresp != processorNum - 1)
+        return;
+    if (busModel == BusModel_t::SPLIT)
+        snoopDone();
+
+    if (!slot.responded) {
+        if (slot.req.event_type == EVENT_TYPE::BUS_UPGR) {
+            respond(slot, EVENT_TYPE::SHARED, DATA_SRC::CACHE);
+        } else {
+            // otherwise, read from memory
+            size_t line = slot.req.addr / blockSize;
+            pendingFills[line];
+            CacheEvent* memEvent = new CacheEvent(slot.req);
+            memEvent->rsp = EVENT_TYPE::NOT_SHARED;
+            memEvent->src = DATA_SRC::MEMORY;
+            slot.memPending = true;
+            sendToMemory(memEvent, 0);
+			totalTraffic ++;
+			memoryTraffic ++;
+            if (slot.req.event_type == EVENT_TYPE::BUS_RD) {
+                busyLines[line].readFill = true;
+                coalesceWaiting(line);
             }
         }
     }
-    delete cacheEvent;
-    // printf("reaching the end of bus handleEvent. addr: %zx from processor_%d\n", cacheEvent->addr, cacheEvent->pid);
+    tryRetire(tag);
+}
+
+void XTSimBus::respond(BusSlot_t& slot, EVENT_TYPE rsp, DATA_SRC src) {
+    slot.req.rsp = rsp;
+    slot.req.src = src;
+    slot.responded = true;
+    if (busModel == BusModel_t::SPLIT && slot.req.event_type != EVENT_TYPE::BUS_UPGR) {
+        transferData(&slot.req);
+    } else {
+        sendEvent(slot.req.pid, &slot.req);
+        complete(slot.req.pid);
+        slot.delivered = true;
+    }
+}
+
+uint32_t XTSimBus::allocSlot() {
+    if (freeSlots.empty()) {
+        slots.emplace_back();
+        return slots.size() - 1;
+    }
+    uint32_t tag = freeSlots.back();
+    freeSlots.pop_back();
+    return tag;
+}
+
+void XTSimBus::freeSlot(uint32_t tag) {
+    freeSlots.push_back(tag);
 }
 
 // fall back to memory access
@@ -123,27 +503,125 @@ void XTSimBus::handleMemEvent(SST::Event *ev) {
 	memoryTraffic ++;
     CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
     // printf("bus heard back from memory with addr: %zx from processor_%d\n", cacheEvent->addr, cacheEvent->pid);
-    sendEvent(cacheEvent->pid, cacheEvent);
-    size_t tid = cacheEvent->transactionId;
-    transactionsMap.erase(tid);
-    delete cacheEvent;
+
+    // reads that joined the fill share the line with its owner, so nobody takes it exclusive
+    size_t line = cacheEvent->addr / blockSize;
+    auto it = pendingFills.find(line);
+    vector<uint32_t> waiters = std::move(it->second);
+    pendingFills.erase(it);
+    busyLines[line].readFill = false;
+    if (!waiters.empty())
+        cacheEvent->rsp = EVENT_TYPE::SHARED;
+
+    uint32_t tag = cacheEvent->busTag;
+    DATA_SRC src = cacheEvent->src; // MEMORY, or LLC when a shared cache sits in front of the channel
+    BusSlot_t& slot = slots[tag];
+    slot.req.rsp = cacheEvent->rsp;
+    slot.responded = true;
+    slot.memPending = false;
+    if (busModel == BusModel_t::SPLIT) {
+        transferData(cacheEvent);
+        delete cacheEvent;
+    } else {
+        // the memory response itself goes on to the requester
+		totalTraffic ++;
+        complete(cacheEvent->pid);
+        links[cacheEvent->pid]->send(cacheEvent);
+        slot.delivered = true;
+    }
+    for (uint32_t w : waiters) {
+        slots[w].memPending = false;
+        respond(slots[w], EVENT_TYPE::SHARED, src);
+    }
+
+    // the last of them to retire hands the line to the next waiting transaction
+    tryRetire(tag);
+    for (uint32_t w : waiters)
+        tryRetire(w);
+    if (arbitration)
+        grantRequests();
 }
 
-void XTSimBus::broadcast(size_t pidToFilter, CacheEvent *ev) {
-    eventsToBcast.clear();
-    for (int i = 0; i < processorNum - 1; i++) {
-        CacheEvent *bcacheEvent = new CacheEvent(ev->event_type, ev->addr, ev->pid, ev->transactionId, ev->cacheLineIdx);
-        eventsToBcast.push_back(bcacheEvent);
+void XTSimBus::writeback(CacheEvent *ev) {
+	totalTraffic ++;
+	memoryTraffic ++;
+	writebackTraffic ++;
+    if (busModel == BusModel_t::SPLIT) {
+        // the block still crosses the data bus, only the address phase is skipped
+        SimTime_t now = getCurrentSimTime(busTc);
+        SimTime_t start = std::max(now, dataFree);
+        dataFree = start + dataCycles;
+        dataStats.transfers++;
+        dataStats.busyCycles += dataCycles;
+        dataStats.waitCycles += start - now;
+        dataStats.maxWait = std::max(dataStats.maxWait, start - now);
+        sendToMemory(ev, dataFree - now);
+    } else {
+        sendToMemory(ev, 0);
+    }
+}
+
+size_t XTSimBus::channelOf(size_t addr) {
+    size_t line = addr / blockSize;
+    size_t page = addr / pageSize;
+    switch (interleave) {
+        case Interleave_t::PAGE:
+            return page;
+        case Interleave_t::XOR:
+            return line ^ page ^ (page / memChannels);
+        default:
+            return line;
     }
-    int sent = 0;
-    for (int i = 0; i < processorNum; ++i) {
-        if (i == pidToFilter)
+}
+
+size_t XTSimBus::homeNode(size_t addr, pid_t pid) {
+    size_t page = addr / pageSize;
+    if (numaPlacement == NumaPlacement_t::INTERLEAVE)
+        return page % numaNodes;
+    auto it = pageHome.find(page);
+    if (it == pageHome.end())
+        it = pageHome.emplace(page, pid * numaNodes / processorNum).first;
+    return it->second;
+}
+
+void XTSimBus::sendToMemory(CacheEvent *ev, SimTime_t delay) {
+    size_t channel;
+    bool remote = false;
+    if (numaNodes) {
+        // a node owns a contiguous group of channels, the address picks one inside the group
+        size_t perNode = memChannels / numaNodes;
+        size_t home = homeNode(ev->addr, ev->pid);
+        channel = home * perNode + channelOf(ev->addr) % perNode;
+        remote = home != (size_t) ev->pid * numaNodes / processorNum;
+    } else {
+        channel = channelOf(ev->addr) % memChannels;
+    }
+
+    MemChannelStats_t& stats = channelStats[channel];
+    if (ev->event_type == EVENT_TYPE::BUS_WB) {
+        stats.writebacks++;
+    } else {
+        stats.reads++;
+    }
+    if (remote) {
+        stats.remote++;
+        delay += remoteLatency;
+    }
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::BUS_MEM, ev->transactionId, ev->addr, ev->event_type,
+        remote, 0, channel);
+    memLinks[channel]->send(delay, busTc, ev);
+}
+
+void XTSimBus::broadcast(uint32_t tag) {
+    // one message for all receivers, each link only gets a small event pointing at it
+    const std::shared_ptr<const SnoopMsg_t>& snoop = slots[tag].snoop;
+    for (size_t i = 0; i < processorNum; ++i) {
+        if (i == (size_t) snoop->pid)
             continue;
 		totalTraffic ++;
 		// reqTraffic ++;
-        // printf("Broadcast event to cache %d %lx\n", i, ev->addr);
-        links[i]->send(eventsToBcast[sent]);
-        sent++;
+        // printf("Broadcast event to cache %d %lx\n", i, snoop->addr);
+        links[i]->send(new SnoopEvent(snoop));
     }
 }
 
@@ -152,19 +630,133 @@ void XTSimBus::sendEvent(pid_t pid, CacheEvent *ev) {
     // printf("Bus sent response of event: %lx to pid: %d\n", ev->addr, pid);
 	totalTraffic ++;
 	// respTraffic ++;
-    CacheEvent *bcacheEvent = new CacheEvent(ev->event_type, ev->addr, ev->pid, ev->transactionId, ev->cacheLineIdx);
+    CacheEvent *bcacheEvent = new CacheEvent(*ev);
     links[pid]->send(bcacheEvent);
 }
 
+void XTSimBus::finish() {
+    elapsedCycles = getCurrentSimTime(busTc) - roiCycle;
+    if (arbitration)
+        arbitration->finish(getCurrentSimTimeNano());
+    counters.flushFinal();
+    trace.close();
+    if (!checkpointOut.empty()) {
+        if (slots.size() != freeSlots.size())
+            out->output("%s: %zu transactions in flight are not part of the checkpoint\n", getName().c_str(), slots.size() - freeSlots.size());
+        Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    }
+}
+
+/*
+ * The state that outlives a transaction: first-touch page placement, the
+ * line grants of the coherence checker and the integrated arbitration.
+ * Either of the last two may be missing on one side, a restored run that
+ * checks coherence needs a checkpoint that did too.
+ */
+void XTSimBus::warmState(Serializer_t& ser) {
+    Checkpoint::expect(ser, out, getName(), "processorNum", processorNum);
+    Checkpoint::expect(ser, out, getName(), "blockSize", blockSize);
+    size_t savedNodes = numaNodes;
+    ser & savedNodes;
+    Checkpoint::map(ser, pageHome, [](Serializer_t& ser, size_t& node) { ser & node; });
+    // placed for another node count, the pages are placed again on their next first touch
+    if (savedNodes != numaNodes)
+        pageHome.clear();
+
+    bool checked = checker != nullptr;
+    ser & checked;
+    if (checked) {
+        if (checker) {
+            checker->checkpoint(ser);
+        } else {
+            CoherenceChecker unused(out, getName());
+            unused.checkpoint(ser);
+        }
+    } else if (checker) {
+        out->fatal(CALL_INFO, -1, "Error! %s checks coherence but its checkpoint was taken without checkCoherence\n", getName().c_str());
+    }
+
+    bool arbitrated = arbitration != nullptr;
+    ser & arbitrated;
+    if (arbitrated) {
+        if (arbitration) {
+            arbitration->checkpoint(ser);
+        } else {
+            Arbitration::skipCheckpoint(ser);
+        }
+    }
+}
+
+bool XTSimBus::flushStats(Cycle_t cycle) {
+    counters.flush();
+    return false;
+}
+
+bool XTSimBus::sampleTic(Cycle_t cycle) {
+    uint64_t lineWaiting = 0;
+    for (auto& busy : busyLines)
+        lineWaiting += busy.second.waiting.size();
+    uint64_t arbQueued = arbitration ? arbitration->queued() : 0;
+    series.sample(getCurrentSimTimeNano(), {slots.size() - freeSlots.size(), lineWaiting, pendingFills.size(),
+        arbQueued, reqTraffic.count(), memoryTraffic.count()});
+    return false;
+}
+
 /*
  * Destructor, clean up our output
  */
 XTSimBus::~XTSimBus() {
 	string content;
-	printf("[interconnect-stat]: totalTraffic:%zu\n", totalTraffic);
-	printf("[interconnect-stat]: reqTraffic:%zu\n", reqTraffic);
-	printf("[interconnect-stat]: respTraffic:%zu\n", respTraffic);
-	printf("[interconnect-stat]: memoryTraffic:%zu\n", memoryTraffic);
-	printf("[interconnect-stat]: total memory access time:%zu ns\n", memoryTraffic * memoryAccessTime);
+	printf("[interconnect-stat]: config%zu totalTraffic:%zu\n", configId, totalTraffic.count());
+	printf("[interconnect-stat]: config%zu reqTraffic:%zu\n", configId, reqTraffic.count());
+	printf("[interconnect-stat]: config%zu respTraffic:%zu\n", configId, respTraffic.count());
+	printf("[interconnect-stat]: config%zu memoryTraffic:%zu\n", configId, memoryTraffic.count());
+	printf("[interconnect-stat]: config%zu writebackTraffic:%zu\n", configId, writebackTraffic.count());
+	printf("[interconnect-stat]: config%zu earlyReplies:%zu\n", configId, earlyReplies.count());
+	printf("[interconnect-stat]: config%zu coalescedFills:%zu\n", configId, coalescedFills.count());
+	printf("[interconnect-stat]: config%zu lineConflicts:%zu maxLineQueue:%zu conflictCycles:%lu\n", configId, lineConflicts.count(), maxLineQueue, conflictCycles.count());
+	if (checker) {
+		printf("[interconnect-stat]: config%zu coherence checked %zu snoop responses, no violations\n", configId, checker->checks());
+		delete checker;
+	}
+	printf("[interconnect-stat]: config%zu total memory access time:%zu ns\n", configId, memoryTraffic.count() * memoryAccessTime);
+	if (arbitration) {
+		arbitration->report(configId);
+		delete arbitration;
+	}
+	if (memChannels > 1) {
+		size_t maxLoad = 0;
+		size_t total = 0;
+		for (size_t i = 0; i < memChannels; i++) {
+			size_t load = channelStats[i].reads + channelStats[i].writebacks;
+			printf("[interconnect-stat]: config%zu channel%zu reads:%zu writebacks:%zu remote:%zu\n",
+				configId, i, channelStats[i].reads.count(), channelStats[i].writebacks.count(), channelStats[i].remote.count());
+			maxLoad = std::max(maxLoad, load);
+			total += load;
+		}
+		// 1.0 is a perfectly even spread, memChannels means one channel got everything
+		double imbalance = total ? (double) maxLoad * memChannels / total : 0.0;
+		printf("[interconnect-stat]: config%zu channel imbalance (max/mean):%f\n", configId, imbalance);
+	}
+	if (numaNodes) {
+		size_t remote = 0;
+		size_t total = 0;
+		for (size_t i = 0; i < memChannels; i++) {
+			remote += channelStats[i].remote;
+			total += channelStats[i].reads + channelStats[i].writebacks;
+		}
+		printf("[interconnect-stat]: config%zu numa nodes:%zu local:%zu remote:%zu remote ratio:%f%%\n",
+			configId, numaNodes, total - remote, remote, total ? (double) remote / total * 100.0 : 0.0);
+	}
+	if (busModel == BusModel_t::SPLIT) {
+		const char* names[2] = {"addr", "data"};
+		BusPhaseStats_t* phases[2] = {&addrStats, &dataStats};
+		for (int i = 0; i < 2; i++) {
+			double utilization = elapsedCycles ? (double) phases[i]->busyCycles / elapsedCycles * 100.0 : 0.0;
+			double meanWait = phases[i]->transfers ? (double) phases[i]->waitCycles / phases[i]->transfers : 0.0;
+			printf("[interconnect-stat]: config%zu %sPhase transfers:%zu busyCycles:%lu utilization:%f%% meanWait:%f maxWait:%lu\n",
+				configId, names[i], phases[i]->transfers.count(), phases[i]->busyCycles.count(), utilization, meanWait, phases[i]->maxWait);
+		}
+	}
     delete out;
 }
@@ -0,0 +1,454 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+#include <stdio.h>
+
+#include "./include/llc.h"
+#include <algorithm>
+
+using namespace SST;
+using namespace SST::xtsim;
+
+void UtilityMonitor::init(size_t sampledSets, size_t associativity) {
+    tags.assign(sampledSets, vector<size_t>());
+    for (vector<size_t>& set : tags)
+        set.reserve(associativity);
+    hits.assign(associativity, 0);
+}
+
+void UtilityMonitor::access(size_t idx, size_t tag) {
+    vector<size_t>& set = tags[idx];
+    auto it = std::find(set.begin(), set.end(), tag);
+    if (it != set.end()) {
+        hits[it - set.begin()]++;
+    } else if (set.size() < hits.size()) {
+        it = set.insert(set.end(), tag);
+    } else {
+        // the least recently used tag falls off the end
+        it = set.end() - 1;
+        *it = tag;
+    }
+    std::rotate(set.begin(), it, it + 1);
+}
+
+uint64_t UtilityMonitor::gain(size_t ways, size_t extra) const {
+    uint64_t sum = 0;
+    for (size_t p = ways; p < ways + extra && p < hits.size(); p++)
+        sum += hits[p];
+    return sum;
+}
+
+void UtilityMonitor::decay() {
+    for (uint64_t& h : hits)
+        h /= 2;
+}
+
+/*
+ * During construction the XTSimLLC component should prepare for simulation
+ * - Read parameters
+ * - Configure links
+ * - Set up the partitioning, UTILITY registers the repartition clock
+ */
+XTSimLLC::XTSimLLC(ComponentId_t id, Params &params) : Component(id) {
+
+    // read configuration
+    out = new Output("", 1, 0, Output::STDOUT);
+
+    bool found;
+    processorNum = params.find<size_t>("processorNum", 0, found);
+    if (!found || processorNum == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs processorNum\n", getName().c_str());
+    cacheSize = params.find<size_t>("cacheSize", 1048576);
+    associativity = params.find<size_t>("associativity", 16);
+    blockSize = params.find<size_t>("blockSize", 64);
+    hitLatency = params.find<SimTime_t>("hitLatency", 10);
+    configId = params.find<size_t>("configId", 0);
+    channels = params.find<size_t>("channels", 1);
+    interleaveSize = params.find<size_t>("interleaveSize", blockSize);
+    if (channels == 0 || interleaveSize == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs non-zero channels and interleaveSize\n", getName().c_str());
+    if (blockSize == 0 || associativity == 0 || cacheSize < blockSize * associativity)
+        out->fatal(CALL_INFO, -1, "Error! %s needs at least one set of blockSize * associativity bytes\n", getName().c_str());
+    nsets = cacheSize / (blockSize * associativity);
+    cacheLines.assign(nsets, vector<LlcLine_t>(associativity));
+
+    size_t partitionMode = params.find<size_t>("partitionMode", 0);
+    if (partitionMode > 2)
+        out->fatal(CALL_INFO, -1, "Error! Invalid partition mode %s!\n", getName().c_str());
+    mode = (PartitionMode_t) partitionMode;
+    size_t allWays = associativity >= 64 ? ~(size_t) 0 : ((size_t) 1 << associativity) - 1;
+    if (mode == PartitionMode_t::WAY_MASK) {
+        params.find_array<size_t>("wayMasks", wayMasks);
+        if (wayMasks.empty())
+            wayMasks.assign(processorNum, allWays);
+        if (wayMasks.size() != processorNum)
+            out->fatal(CALL_INFO, -1, "Error! %s needs one way mask per core, got %zu for %zu cores\n",
+                getName().c_str(), wayMasks.size(), processorNum);
+        for (size_t& mask : wayMasks) {
+            mask &= allWays;
+            if (mask == 0)
+                out->fatal(CALL_INFO, -1, "Error! %s has a way mask without any of its %zu ways\n", getName().c_str(), associativity);
+        }
+    } else if (mode == PartitionMode_t::UTILITY) {
+        if (associativity < processorNum)
+            out->fatal(CALL_INFO, -1, "Error! %s needs at least one way per core to partition by utility\n", getName().c_str());
+        umonSampleSets = std::max<size_t>(params.find<size_t>("umonSampleSets", 32), 1);
+        // start from an even split, the remainder goes to the first cores
+        quota.assign(processorNum, associativity / processorNum);
+        for (size_t i = 0; i < associativity % processorNum; i++)
+            quota[i]++;
+        monitors.resize(processorNum);
+        for (UtilityMonitor& monitor : monitors)
+            monitor.init((nsets + umonSampleSets - 1) / umonSampleSets, associativity);
+    }
+
+    // configure our links with a callback function that will be called whenever an event arrives
+    busLink = configureLink("busPort", new Event::Handler<XTSimLLC>(this, &XTSimLLC::handleBusEvent));
+    memLink = configureLink("memPort", new Event::Handler<XTSimLLC>(this, &XTSimLLC::handleMemEvent));
+    sst_assert(busLink, CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+    sst_assert(memLink, CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+
+    llcTc = getTimeConverter(params.find<string>("llcClock", "1GHz"));
+    if (mode == PartitionMode_t::UTILITY)
+        registerClock(params.find<string>("repartitionPeriod", "10us"), new Clock::Handler<XTSimLLC>(this, &XTSimLLC::repartition), false);
+
+    // lookups only bump local counters, they reach the statistics every statFlushPeriod and at finish
+    coreStats.resize(processorNum);
+    for (size_t i = 0; i < processorNum; ++i) {
+        string core = std::to_string(i);
+        counters.add(coreStats[i].hits, registerStatistic<uint64_t>("llcHits", core));
+        counters.add(coreStats[i].misses, registerStatistic<uint64_t>("llcMisses", core));
+        counters.add(coreStats[i].writebacks, registerStatistic<uint64_t>("llcWritebacks", core));
+    }
+    counters.add(memWritebacks, registerStatistic<uint64_t>("memWritebacks"));
+    counters.add(repartitions, registerStatistic<uint64_t>("repartitions"));
+    string flushPeriod = params.find<string>("statFlushPeriod", "10us");
+    if (flushPeriod != "0")
+        registerClock(flushPeriod, new Clock::Handler<XTSimLLC>(this, &XTSimLLC::flushStats), false);
+    // lookups before the region of interest stay local with roiMode 2
+    if (params.find<size_t>("roiMode", 0) == 2)
+        counters.hold();
+    string sampleInterval = params.find<string>("sampleInterval", "0");
+    if (sampleInterval != "0") {
+        vector<TimeSeries::Column_t> columns = {{"hits", TimeSeries::DELTA}, {"misses", TimeSeries::DELTA}};
+        for (size_t i = 0; i < processorNum; ++i)
+            columns.push_back({"occupancy" + std::to_string(i), TimeSeries::LEVEL});
+        series.open(out, params.find<string>("timeSeriesPrefix", ""), getName(), columns);
+        registerClock(sampleInterval, new Clock::Handler<XTSimLLC>(this, &XTSimLLC::sampleTic), false);
+    }
+
+    string checkpointIn = params.find<string>("checkpointIn", "");
+    if (!checkpointIn.empty())
+        Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    checkpointOut = params.find<string>("checkpointOut", "");
+}
+
+// squeeze out the channel bits like the memory does, so every set of the slice is used
+size_t XTSimLLC::getSetIndex(size_t addr) {
+    size_t chunk = interleaveSize * channels;
+    size_t localAddr = addr / chunk * interleaveSize + addr % interleaveSize;
+    return localAddr / blockSize % nsets;
+}
+
+LlcLine_t* XTSimLLC::lookup(size_t addr) {
+    size_t address = addr / blockSize * blockSize;
+    for (LlcLine_t& line : cacheLines[getSetIndex(addr)]) {
+        if (line.valid && line.address == address)
+            return &line;
+    }
+    return nullptr;
+}
+
+// requests from the bus, reads wait for data and write backs are posted
+void XTSimLLC::handleBusEvent(SST::Event* ev) {
+    CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
+    if (cacheEvent == NULL) {
+        printf("Cast failed\n");
+        return;
+    }
+    if (cacheEvent->event_type == EVENT_TYPE::ROI_BEGIN) {
+        resetStats();
+        memLink->send(cacheEvent);
+        return;
+    }
+    size_t core = cacheEvent->pid;
+    if (core >= processorNum)
+        out->fatal(CALL_INFO, -1, "Error! %s got a request of core %zu\n", getName().c_str(), core);
+
+    timestamp++;
+    LlcLine_t* line = lookup(cacheEvent->addr);
+    if (cacheEvent->event_type == EVENT_TYPE::BUS_WB) {
+        coreStats[core].writebacks++;
+        if (line == nullptr)
+            line = &allocate(cacheEvent->addr, core);
+        line->dirty = true;
+        line->timestamp = timestamp;
+        delete cacheEvent;
+        return;
+    }
+
+    size_t idx = getSetIndex(cacheEvent->addr);
+    if (mode == PartitionMode_t::UTILITY && idx % umonSampleSets == 0)
+        monitors[core].access(idx / umonSampleSets, cacheEvent->addr / blockSize);
+    if (line) {
+        coreStats[core].hits++;
+        line->timestamp = timestamp;
+        cacheEvent->src = DATA_SRC::LLC;
+        busLink->send(hitLatency, llcTc, cacheEvent);
+    } else {
+        coreStats[core].misses++;
+        memLink->send(hitLatency, llcTc, cacheEvent);
+    }
+}
+
+// a miss came back from memory, fill it on the way to the bus
+void XTSimLLC::handleMemEvent(SST::Event* ev) {
+    CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
+    if (cacheEvent == NULL) {
+        printf("Cast failed\n");
+        return;
+    }
+    // a write back of the line may have allocated it meanwhile, its data is the newer one
+    if (lookup(cacheEvent->addr) == nullptr) {
+        timestamp++;
+        allocate(cacheEvent->addr, cacheEvent->pid);
+    }
+    busLink->send(cacheEvent);
+}
+
+LlcLine_t& XTSimLLC::allocate(size_t addr, size_t core) {
+    LlcLine_t& victim = pickVictim(cacheLines[getSetIndex(addr)], core);
+    if (victim.valid) {
+        LlcCoreStats_t& owner = coreStats[victim.owner];
+        touchOccupancy(victim.owner);
+        owner.occupancy--;
+        if (victim.dirty) {
+            memLink->send(new CacheEvent(EVENT_TYPE::BUS_WB, victim.address, victim.owner, 0));
+            memWritebacks++;
+        }
+    }
+    victim.valid = true;
+    victim.dirty = false;
+    victim.address = addr / blockSize * blockSize;
+    victim.owner = core;
+    victim.timestamp = timestamp;
+    LlcCoreStats_t& stats = coreStats[core];
+    touchOccupancy(core);
+    stats.occupancy++;
+    stats.maxOccupancy = std::max(stats.maxOccupancy, stats.occupancy);
+    return victim;
+}
+
+/*
+ * The replacement path, the timestamp LRU of the private caches narrowed to
+ * the lines the partitioning lets the core evict. Hits are never restricted,
+ * a core reads whatever line it finds in the set.
+ *  SHARED: any line of the set.
+ *  WAY_MASK: only the ways in the core's mask, like CAT class of service masks.
+ *  UTILITY: a core under its quota in the set takes a line of a core over its
+ *  quota, one at its quota replaces its own least recently used line.
+ */
+LlcLine_t& XTSimLLC::pickVictim(vector<LlcLine_t>& cacheSet, size_t core) {
+    bool masked = mode == PartitionMode_t::WAY_MASK;
+    for (size_t i = 0; i < associativity; i++) {
+        if (masked && !(wayMasks[core] >> i & 1))
+            continue;
+        if (cacheSet[i].valid == false)
+            return cacheSet[i];
+    }
+
+    auto lru = [&](auto eligible) -> LlcLine_t* {
+        LlcLine_t* victim = nullptr;
+        for (size_t i = 0; i < associativity; i++) {
+            if (eligible(i) && (victim == nullptr || cacheSet[i].timestamp < victim->timestamp))
+                victim = &cacheSet[i];
+        }
+        return victim;
+    };
+
+    LlcLine_t* victim = nullptr;
+    switch (mode) {
+        case PartitionMode_t::WAY_MASK:
+            victim = lru([&](size_t i) { return (wayMasks[core] >> i & 1) != 0; });
+            break;
+        case PartitionMode_t::UTILITY: {
+            vector<size_t> owned(processorNum, 0);
+            for (LlcLine_t& line : cacheSet)
+                owned[line.owner]++;
+            if (owned[core] < quota[core]) {
+                victim = lru([&](size_t i) { return owned[cacheSet[i].owner] > quota[cacheSet[i].owner]; });
+            } else {
+                victim = lru([&](size_t i) { return cacheSet[i].owner == core; });
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    // the quotas add up to the associativity, so a full set always has a core over its quota
+    if (victim == nullptr)
+        victim = lru([](size_t) { return true; });
+    return *victim;
+}
+
+// close the occupancy interval of core before its line count changes
+void XTSimLLC::touchOccupancy(size_t core) {
+    LlcCoreStats_t& stats = coreStats[core];
+    SimTime_t now = getCurrentSimTimeNano();
+    stats.occupancyArea += stats.occupancy * (now - stats.lastChange);
+    stats.lastChange = now;
+}
+
+void XTSimLLC::resetStats() {
+    counters.reset();
+    series.rebase();
+    for (size_t i = 0; i < processorNum; ++i) {
+        touchOccupancy(i);
+        coreStats[i].occupancyArea = 0;
+        coreStats[i].maxOccupancy = coreStats[i].occupancy;
+    }
+    roiNs = getCurrentSimTimeNano();
+}
+
+/*
+ * Lookahead allocation of utility-based cache partitioning. Every core keeps
+ * one way, then the remaining ways go in rounds to the core with the highest
+ * hits per extra way over any number of extra ways, so a core whose curve
+ * only bends after several ways still gets them.
+ */
+bool XTSimLLC::repartition(Cycle_t cycle) {
+    vector<size_t> next(processorNum, 1);
+    size_t balance = associativity - processorNum;
+    while (balance > 0) {
+        size_t winner = 0;
+        size_t winnerWays = 1;
+        double best = -1.0;
+        for (size_t c = 0; c < processorNum; c++) {
+            for (size_t extra = 1; extra <= balance; extra++) {
+                double utility = (double) monitors[c].gain(next[c], extra) / extra;
+                if (utility > best) {
+                    best = utility;
+                    winner = c;
+                    winnerWays = extra;
+                }
+            }
+        }
+        next[winner] += winnerWays;
+        balance -= winnerWays;
+    }
+    if (next != quota) {
+        quota = next;
+        repartitions++;
+    }
+    for (UtilityMonitor& monitor : monitors)
+        monitor.decay();
+    return false;
+}
+
+void XTSimLLC::finish() {
+    elapsedNs = getCurrentSimTimeNano() - roiNs;
+    for (size_t i = 0; i < processorNum; ++i)
+        touchOccupancy(i);
+    counters.flushFinal();
+    if (!checkpointOut.empty())
+        Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
+}
+
+/*
+ * Lines with their owners and LRU timestamps, then the UTILITY quotas and
+ * monitors. A run that partitions another way, or samples other sets, keeps
+ * the lines and starts its own partitioning state cold.
+ */
+void XTSimLLC::warmState(Serializer_t& ser) {
+    Checkpoint::expect(ser, out, getName(), "processorNum", processorNum);
+    Checkpoint::expect(ser, out, getName(), "cacheSize", cacheSize);
+    Checkpoint::expect(ser, out, getName(), "associativity", associativity);
+    Checkpoint::expect(ser, out, getName(), "blockSize", blockSize);
+    ser & timestamp;
+    for (vector<LlcLine_t>& cacheSet : cacheLines) {
+        for (LlcLine_t& line : cacheSet) {
+            ser & line.valid;
+            ser & line.dirty;
+            ser & line.address;
+            ser & line.owner;
+            ser & line.timestamp;
+            if (ser.mode() == Serializer_t::UNPACK && line.valid) {
+                LlcCoreStats_t& stats = coreStats[line.owner];
+                stats.occupancy++;
+                stats.maxOccupancy = stats.occupancy;
+            }
+        }
+    }
+
+    vector<size_t> savedQuota = quota;
+    vector<UtilityMonitor> savedMonitors = monitors;
+    size_t nmonitors = savedMonitors.size();
+    ser & savedQuota;
+    ser & nmonitors;
+    savedMonitors.resize(nmonitors);
+    for (UtilityMonitor& monitor : savedMonitors)
+        monitor.checkpoint(ser);
+    if (ser.mode() == Serializer_t::UNPACK && mode == PartitionMode_t::UTILITY && savedQuota.size() == processorNum) {
+        quota = savedQuota;
+        if (savedMonitors.size() == processorNum && savedMonitors[0].sampledSets() == monitors[0].sampledSets())
+            monitors = savedMonitors;
+    }
+}
+
+bool XTSimLLC::flushStats(Cycle_t cycle) {
+    counters.flush();
+    return false;
+}
+
+bool XTSimLLC::sampleTic(Cycle_t cycle) {
+    vector<uint64_t> values = {0, 0};
+    for (LlcCoreStats_t& stats : coreStats) {
+        values[0] += stats.hits.count();
+        values[1] += stats.misses.count();
+    }
+    for (LlcCoreStats_t& stats : coreStats)
+        values.push_back(stats.occupancy);
+    series.sample(getCurrentSimTimeNano(), values);
+    return false;
+}
+
+/*
+ * Destructor, clean up our output
+ */
+XTSimLLC::~XTSimLLC()
+{
+    const char* modeNames[3] = {"shared", "way mask", "utility"};
+    size_t lines = nsets * associativity;
+    printf("[llc-stat]: config%zu %s sets: %zu associativity: %zu partition: %s memWritebacks: %zu repartitions: %zu\n",
+        configId, getName().c_str(), nsets, associativity, modeNames[(int) mode], memWritebacks.count(), repartitions.count());
+    for (size_t i = 0; i < processorNum; ++i) {
+        LlcCoreStats_t& stats = coreStats[i];
+        size_t accesses = stats.hits + stats.misses;
+        double meanOccupancy = elapsedNs ? (double) stats.occupancyArea / elapsedNs : 0.0;
+        printf("[llc-stat]: config%zu %s core%zu hits: %zu misses: %zu miss rate: %f%% writebacks: %zu mean occupancy: %f%% max occupancy: %f%%",
+            configId, getName().c_str(), i, stats.hits.count(), stats.misses.count(),
+            accesses ? (double) stats.misses / accesses * 100.0 : 0.0, stats.writebacks.count(),
+            meanOccupancy / lines * 100.0, (double) stats.maxOccupancy / lines * 100.0);
+        if (mode == PartitionMode_t::WAY_MASK)
+            printf(" mask: 0x%zx", wayMasks[i]);
+        if (mode == PartitionMode_t::UTILITY)
+            printf(" ways: %zu", quota[i]);
+        printf("\n");
+    }
+    delete out;
+}
@@ -19,23 +19,47 @@
 #include "sst_config.h"
 
 #include "./include/memory.h"
+#include <algorithm>
 
 using namespace SST;
 using namespace SST::xtsim;
 
 /*
- * During construction the XTSimGenerator component should prepare for simulation
+ * During construction the XTSimMemory component should prepare for simulation
  * - Read parameters
  * - Configure link
- * - Register its clock
- * - Send event for every clock ticking
- * - Register statistics
+ * - Register its clock, it only ticks while requests are queued
  */
 XTSimMemory::XTSimMemory(ComponentId_t id, Params &params) : Component(id) {
 
     // read configuration
     out = new Output("", 1, 0, Output::STDOUT);
 
+    ranks = params.find<size_t>("ranks", 1);
+    banks = params.find<size_t>("banks", 8);
+    size_t rowSize = params.find<size_t>("rowSize", 2048);
+    blockSize = params.find<size_t>("blockSize", 64);
+    pagePolicy = params.find<size_t>("pagePolicy", 0) == 1 ? PagePolicy_t::CLOSED : PagePolicy_t::OPEN;
+    tRCD = params.find<SimTime_t>("tRCD", 14);
+    tCAS = params.find<SimTime_t>("tCAS", 14);
+    tRP = params.find<SimTime_t>("tRP", 14);
+    tBurst = params.find<SimTime_t>("tBurst", 4);
+    readQueueSize = params.find<size_t>("readQueueSize", 32);
+    writeQueueSize = params.find<size_t>("writeQueueSize", 32);
+    writeHighWatermark = params.find<size_t>("writeHighWatermark", 24);
+    writeLowWatermark = params.find<size_t>("writeLowWatermark", 8);
+    configId = params.find<size_t>("configId", 0);
+    channels = params.find<size_t>("channels", 1);
+    interleaveSize = params.find<size_t>("interleaveSize", blockSize);
+    if (channels == 0 || interleaveSize == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs non-zero channels and interleaveSize\n", getName().c_str());
+    if (ranks == 0 || banks == 0 || blockSize == 0 || rowSize < blockSize)
+        out->fatal(CALL_INFO, -1, "Error! %s needs non-zero ranks and banks and a row of at least one block\n", getName().c_str());
+    if (readQueueSize == 0 || writeLowWatermark >= writeHighWatermark || writeHighWatermark > writeQueueSize)
+        out->fatal(CALL_INFO, -1, "Error! %s needs writeLowWatermark < writeHighWatermark <= writeQueueSize\n", getName().c_str());
+    linesPerRow = rowSize / blockSize;
+    bankState.resize(ranks * banks);
+
     // configure our link with a callback function that will be called whenever an event arrives
     // Callback function is optional, if not provided then component must poll the link
     link = configureLink("port", new Event::Handler<XTSimMemory>(this, &XTSimMemory::handleEvent));
@@ -43,21 +67,256 @@ XTSimMemory::XTSimMemory(ComponentId_t id, Params &params) : Component(id) {
     // Make sure we successfully configured the links
     // Failure usually means the user didn't connect the port in the input file
     sst_assert(link, CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+
+    // the handler unregisters itself on the first idle tick
+    clockHandler = new Clock::Handler<XTSimMemory>(this, &XTSimMemory::clockTic);
+    memTc = registerClock(params.find<string>("memClock", "1GHz"), clockHandler);
+    clockOn = true;
+
+    // the scheduler only bumps local counters, they reach the statistics every statFlushPeriod and at finish
+    counters.add(reads, registerStatistic<uint64_t>("reads"));
+    counters.add(writes, registerStatistic<uint64_t>("writes"));
+    counters.add(forwardedReads, registerStatistic<uint64_t>("forwardedReads"));
+    counters.add(rowHits, registerStatistic<uint64_t>("rowHits"));
+    counters.add(rowMisses, registerStatistic<uint64_t>("rowMisses"));
+    counters.add(rowConflicts, registerStatistic<uint64_t>("rowConflicts"));
+    counters.add(writeDrains, registerStatistic<uint64_t>("writeDrains"));
+    counters.add(readLatency, registerStatistic<uint64_t>("readLatency"), true);
+    counters.add(readOccupancy, registerStatistic<uint64_t>("readOccupancy"), true);
+    counters.add(writeOccupancy, registerStatistic<uint64_t>("writeOccupancy"), true);
+    counters.add(busyCycles, registerStatistic<uint64_t>("busyCycles"), true);
+    string flushPeriod = params.find<string>("statFlushPeriod", "10us");
+    if (flushPeriod != "0")
+        registerClock(flushPeriod, new Clock::Handler<XTSimMemory>(this, &XTSimMemory::flushStats), false);
+    // with roiMode 2 the statistics start at the region of interest
+    if (params.find<size_t>("roiMode", 0) == 2)
+        counters.hold();
+    string sampleInterval = params.find<string>("sampleInterval", "0");
+    if (sampleInterval != "0") {
+        series.open(out, params.find<string>("timeSeriesPrefix", ""), getName(), {
+            {"reads", TimeSeries::DELTA}, {"writes", TimeSeries::DELTA},
+            {"readQueue", TimeSeries::LEVEL}, {"writeQueue", TimeSeries::LEVEL}});
+        registerClock(sampleInterval, new Clock::Handler<XTSimMemory>(this, &XTSimMemory::sampleTic), false);
+    }
+    trace.open(params, out, getName());
+
+    string checkpointIn = params.find<string>("checkpointIn", "");
+    if (!checkpointIn.empty())
+        Checkpoint::restore(out, checkpointIn, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    checkpointOut = params.find<string>("checkpointOut", "");
 }
 
 
-// the end of instruction's lifecycle
+// the end of instruction's lifecycle, queue the access for the scheduler
 void XTSimMemory::handleEvent(SST::Event* ev){
-    // printf("Memory received event ev %p\n", ev);
     CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
-    // printf("Memory received %d %lx\n", cacheEvent->event_type, cacheEvent->addr);
     if (cacheEvent == NULL) {
         printf("Cast failed\n");
+        return;
+    }
+    if (cacheEvent->event_type == EVENT_TYPE::ROI_BEGIN) {
+        resetStats();
+        delete cacheEvent;
+        return;
+    }
+
+    // squeeze out the channel bits, then row:rank:bank:column mapping keeps consecutive lines in one row
+    size_t chunk = interleaveSize * channels;
+    size_t localAddr = cacheEvent->addr / chunk * interleaveSize + cacheEvent->addr % interleaveSize;
+    DramRequest_t req;
+    req.line = localAddr / blockSize;
+    size_t rowIdx = req.line / linesPerRow;
+    req.bank = rowIdx % banks;
+    req.rank = (rowIdx / banks) % ranks;
+    req.row = rowIdx / banks / ranks;
+    req.arrival = getCurrentSimTime(memTc);
+    req.addr = cacheEvent->addr;
+    req.transactionId = cacheEvent->transactionId;
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::MEM_ARRIVE, req.transactionId, req.addr, cacheEvent->event_type);
+
+    if (cacheEvent->event_type == EVENT_TYPE::BUS_WB) {
+        // posted write, nobody waits for it
+        writes++;
+        req.write = true;
+        req.ev = nullptr;
+        delete cacheEvent;
+        if (writeQueue.size() < writeQueueSize && writeOverflow.empty()) {
+            writeQueue.push_back(req);
+        } else {
+            writeOverflow.push_back(req);
+        }
+    } else {
+        reads++;
+        if (forwardFromWrites(req.line)) {
+            forwardedReads++;
+            link->send(cacheEvent);
+            return;
+        }
+        req.write = false;
+        req.ev = cacheEvent;
+        if (readQueue.size() < readQueueSize && readOverflow.empty()) {
+            readQueue.push_back(req);
+        } else {
+            readOverflow.push_back(req);
+        }
+    }
+
+    if (!clockOn) {
+        reregisterClock(memTc, clockHandler);
+        clockOn = true;
+    }
+}
+
+// a read of a line with a queued write gets the write's data without touching DRAM
+bool XTSimMemory::forwardFromWrites(size_t line) {
+    for (DramRequest_t& w : writeQueue) {
+        if (w.line == line)
+            return true;
+    }
+    for (DramRequest_t& w : writeOverflow) {
+        if (w.line == line)
+            return true;
+    }
+    return false;
+}
+
+void XTSimMemory::fillQueue(deque<DramRequest_t>& queue, deque<DramRequest_t>& overflow, size_t size) {
+    while (queue.size() < size && !overflow.empty()) {
+        queue.push_back(overflow.front());
+        overflow.pop_front();
+    }
+}
+
+// FR-FCFS, the oldest row hit on a ready bank first, then the oldest request on a ready bank
+int XTSimMemory::pickRequest(deque<DramRequest_t>& queue, SimTime_t now) {
+    int oldestReady = -1;
+    for (size_t i = 0; i < queue.size(); i++) {
+        DramBank_t& bank = bankState[queue[i].rank * banks + queue[i].bank];
+        if (bank.readyAt > now)
+            continue;
+        if (bank.open && bank.row == queue[i].row)
+            return i;
+        if (oldestReady < 0)
+            oldestReady = i;
+    }
+    return oldestReady;
+}
+
+void XTSimMemory::issue(DramRequest_t& req, SimTime_t now) {
+    DramBank_t& bank = bankState[req.rank * banks + req.bank];
+    SimTime_t activate;
+    uint8_t rowOutcome;
+    if (bank.open && bank.row == req.row) {
+        rowHits++;
+        activate = 0;
+        rowOutcome = 0;
+    } else if (bank.open) {
+        rowConflicts++;
+        activate = tRP + tRCD;
+        rowOutcome = 2;
+    } else {
+        rowMisses++;
+        activate = tRCD;
+        rowOutcome = 1;
     }
-    CacheEvent *bcacheEvent = new CacheEvent(cacheEvent->event_type, cacheEvent->addr, cacheEvent->pid, 
-    cacheEvent->transactionId, cacheEvent->cacheLineIdx);
-	link->send(bcacheEvent);
-    // delete cacheEvent;
+    XTSIM_TRACE_RECORD(trace, getCurrentSimTimeNano(), TraceKind::MEM_ISSUE, req.transactionId, req.addr,
+        req.ev ? req.ev->event_type : EVENT_TYPE::BUS_WB, rowOutcome);
+
+    SimTime_t start = std::max(now + activate + tCAS, dataFree);
+    SimTime_t done = start + tBurst;
+    dataFree = done;
+    busyCycles += tBurst;
+    if (pagePolicy == PagePolicy_t::OPEN) {
+        // column commands to the open row can follow each other every burst
+        bank.open = true;
+        bank.row = req.row;
+        bank.readyAt = now + activate + tBurst;
+    } else {
+        bank.open = false;
+        bank.readyAt = done + tRP;
+    }
+
+    if (!req.write) {
+        readLatency += done - req.arrival;
+        link->send(done - now, memTc, req.ev);
+    }
+}
+
+bool XTSimMemory::clockTic(SST::Cycle_t cycle) {
+    SimTime_t now = getCurrentSimTime(memTc);
+    fillQueue(readQueue, readOverflow, readQueueSize);
+    fillQueue(writeQueue, writeOverflow, writeQueueSize);
+    readOccupancy += readQueue.size();
+    writeOccupancy += writeQueue.size();
+    maxReadQueue = std::max(maxReadQueue, readQueue.size() + readOverflow.size());
+    maxWriteQueue = std::max(maxWriteQueue, writeQueue.size() + writeOverflow.size());
+
+    // reads go first, writes drain between the watermarks or when no read waits
+    if (drainingWrites) {
+        if (writeQueue.size() <= writeLowWatermark)
+            drainingWrites = false;
+    } else if (writeQueue.size() >= writeHighWatermark) {
+        drainingWrites = true;
+        writeDrains++;
+    }
+    deque<DramRequest_t>& queue = drainingWrites || readQueue.empty() ? writeQueue : readQueue;
+    int idx = pickRequest(queue, now);
+    if (idx >= 0) {
+        issue(queue[idx], now);
+        queue.erase(queue.begin() + idx);
+    }
+
+    if (readQueue.empty() && writeQueue.empty() && readOverflow.empty() && writeOverflow.empty()) {
+        clockOn = false;
+        return true;
+    }
+    return false;
+}
+
+void XTSimMemory::finish() {
+    elapsedCycles = getCurrentSimTime(memTc) - roiCycle;
+    elapsedNs = getCurrentSimTimeNano() - roiNs;
+    counters.flushFinal();
+    trace.close();
+    if (!checkpointOut.empty()) {
+        size_t pending = readQueue.size() + writeQueue.size() + readOverflow.size() + writeOverflow.size();
+        if (pending)
+            out->output("%s: %zu queued requests are not part of the checkpoint\n", getName().c_str(), pending);
+        Checkpoint::save(out, checkpointOut, getName(), [this](Serializer_t& ser) { warmState(ser); });
+    }
+}
+
+// The open row of every bank, bank timing restarts idle with the restored run's clock
+void XTSimMemory::warmState(Serializer_t& ser) {
+    Checkpoint::expect(ser, out, getName(), "ranks", ranks);
+    Checkpoint::expect(ser, out, getName(), "banks", banks);
+    Checkpoint::expect(ser, out, getName(), "rowSize", linesPerRow * blockSize);
+    for (DramBank_t& bank : bankState) {
+        ser & bank.open;
+        ser & bank.row;
+        // a closed page policy precharges after every access, no row stays open
+        if (pagePolicy == PagePolicy_t::CLOSED)
+            bank.open = false;
+    }
+}
+
+void XTSimMemory::resetStats() {
+    counters.reset();
+    series.rebase();
+    maxReadQueue = 0;
+    maxWriteQueue = 0;
+    roiCycle = getCurrentSimTime(memTc);
+    roiNs = getCurrentSimTimeNano();
+}
+
+bool XTSimMemory::flushStats(Cycle_t cycle) {
+    counters.flush();
+    return false;
+}
+
+bool XTSimMemory::sampleTic(Cycle_t cycle) {
+    series.sample(getCurrentSimTimeNano(), {reads.count(), writes.count(), readQueue.size(), writeQueue.size()});
+    return false;
 }
 
 /*
@@ -65,5 +324,17 @@ void XTSimMemory::handleEvent(SST::Event* ev){
  */
 XTSimMemory::~XTSimMemory()
 {
+    size_t accesses = rowHits + rowMisses + rowConflicts;
+    size_t dramReads = reads - forwardedReads;
+    printf("[memory-stat]: config%zu reads:%zu writes:%zu forwardedReads:%zu row hit rate:%f%% rowHits:%zu rowMisses:%zu rowConflicts:%zu\n",
+        configId, reads.count(), writes.count(), forwardedReads.count(), accesses ? (double) rowHits / accesses * 100.0 : 0.0,
+        rowHits.count(), rowMisses.count(), rowConflicts.count());
+    printf("[memory-stat]: config%zu mean read latency:%f cycles mean readQueue:%f maxReadQueue:%zu mean writeQueue:%f maxWriteQueue:%zu writeDrains:%zu\n",
+        configId, dramReads ? (double) readLatency / dramReads : 0.0,
+        elapsedCycles ? (double) readOccupancy / elapsedCycles : 0.0, maxReadQueue,
+        elapsedCycles ? (double) writeOccupancy / elapsedCycles : 0.0, maxWriteQueue, writeDrains.count());
+    printf("[memory-stat]: config%zu bandwidth:%f GB/s data bus utilization:%f%%\n", configId,
+        elapsedNs ? (double) accesses * blockSize / elapsedNs : 0.0,
+        elapsedCycles ? (double) busyCycles / elapsedCycles * 100.0 : 0.0);
     delete out;
 }
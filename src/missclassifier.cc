@@ -0,0 +1,146 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/missclassifier.h"
+#include <algorithm>
+
+using namespace SST;
+using namespace SST::xtsim;
+
+MissClassifier::MissClassifier(size_t nlines, size_t blockSize, size_t wordSize) :
+    nlines(nlines), blockSize(blockSize), wordSize(wordSize) { }
+
+uint64_t MissClassifier::wordMask(size_t addr, size_t size) {
+    // Blocks with more than 64 words share mask bits between neighbouring words
+    size_t first = (addr % blockSize) / wordSize;
+    size_t last = size ? (addr % blockSize + size - 1) / wordSize : first;
+    uint64_t mask = 0;
+    for (size_t word = first; word <= last && word < first + 64; word++)
+        mask |= 1ull << (word % 64);
+    return mask;
+}
+
+MissClass_t MissClassifier::classify(size_t addr, size_t size, size_t pc) {
+    size_t line = addr / blockSize;
+    if (!seen.count(line)) {
+        seen.insert(line);
+        return MissClass_t::COMPULSORY;
+    }
+
+    auto inv = invalidated.find(line);
+    if (inv != invalidated.end()) {
+        bool trueSharing = (inv->second & wordMask(addr, size)) != 0;
+        invalidated.erase(inv);
+        if (trueSharing) {
+            lineSharing[line].trueSharing++;
+            pcSharing[pc].trueSharing++;
+            return MissClass_t::TRUE_SHARING;
+        }
+        lineSharing[line].falseSharing++;
+        pcSharing[pc].falseSharing++;
+        return MissClass_t::FALSE_SHARING;
+    }
+
+    if (lruMap.count(line)) {
+        return MissClass_t::CONFLICT;
+    }
+    return MissClass_t::CAPACITY;
+}
+
+void MissClassifier::access(size_t addr) {
+    size_t line = addr / blockSize;
+    auto it = lruMap.find(line);
+    if (it != lruMap.end()) {
+        lruList.splice(lruList.begin(), lruList, it->second);
+        return;
+    }
+    if (lruList.size() == nlines) {
+        lruMap.erase(lruList.back());
+        lruList.pop_back();
+    }
+    lruList.push_front(line);
+    lruMap[line] = lruList.begin();
+}
+
+void MissClassifier::invalidate(size_t addr, size_t size, bool hadLine) {
+    size_t line = addr / blockSize;
+    if (hadLine) {
+        // The line leaves the shadow too, so a later miss is not counted as conflict
+        auto it = lruMap.find(line);
+        if (it != lruMap.end()) {
+            lruList.erase(it->second);
+            lruMap.erase(it);
+        }
+        invalidated[line] |= wordMask(addr, size);
+        return;
+    }
+    // Further remote writes while we still miss the line widen the mask
+    auto inv = invalidated.find(line);
+    if (inv != invalidated.end()) {
+        inv->second |= wordMask(addr, size);
+    }
+}
+
+void MissClassifier::checkpoint(Serializer_t& ser) {
+    std::vector<size_t> seenLines(seen.begin(), seen.end());
+    std::sort(seenLines.begin(), seenLines.end());
+    ser & seenLines;
+    // the shadow LRU goes out most recently used first and is rebuilt in that order
+    std::vector<size_t> lruOrder(lruList.begin(), lruList.end());
+    ser & lruOrder;
+    Checkpoint::map(ser, invalidated, [](Serializer_t& ser, uint64_t& mask) { ser & mask; });
+    if (ser.mode() == Serializer_t::UNPACK) {
+        seen = std::unordered_set<size_t>(seenLines.begin(), seenLines.end());
+        lruList.clear();
+        lruMap.clear();
+        for (size_t line : lruOrder) {
+            lruList.push_back(line);
+            lruMap[line] = std::prev(lruList.end());
+        }
+    }
+}
+
+void MissClassifier::reportTop(const char* prefix, const char* what, std::unordered_map<size_t, SharingCount_t>& counts,
+    size_t topN, size_t scale) {
+    std::vector<std::pair<size_t, SharingCount_t>> ranked(counts.begin(), counts.end());
+    size_t n = std::min(topN, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + n, ranked.end(),
+        [](const std::pair<size_t, SharingCount_t>& a, const std::pair<size_t, SharingCount_t>& b) {
+            if (a.second.falseSharing != b.second.falseSharing)
+                return a.second.falseSharing > b.second.falseSharing;
+            return a.second.trueSharing > b.second.trueSharing;
+        });
+    for (size_t i = 0; i < n; i++) {
+        printf("%s   %s 0x%lx false sharing: %lu true sharing: %lu\n", prefix, what,
+            ranked[i].first * scale,
+            ranked[i].second.falseSharing, ranked[i].second.trueSharing);
+    }
+}
+
+void MissClassifier::report(size_t configId, size_t cacheId, size_t topN) {
+    if (topN == 0)
+        return;
+    // shadow configurations of a lockstep run share cache ids, the config tells them apart
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "[miss-class]: config%zu cache%zu", configId, cacheId);
+    printf("%s top %lu coherence miss lines:\n", prefix, topN);
+    reportTop(prefix, "line", lineSharing, topN, blockSize);
+    printf("%s top %lu coherence miss pcs:\n", prefix, topN);
+    reportTop(prefix, "pc", pcSharing, topN, 1);
+}
@@ -0,0 +1,521 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+
+#include "./include/noc.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+static const size_t NO_ROUTER = (size_t) -1;
+
+/*
+ * During construction the XTSimNoC component should prepare for simulation
+ * - Read parameters
+ * - Build the router and link tables of the topology
+ * - Configure the cache, memory and router pipeline links
+ */
+XTSimNoC::XTSimNoC(ComponentId_t id, Params &params) : Component(id) {
+
+    // read configuration
+    out = new Output("", 1, 0, Output::STDOUT);
+
+    processorNum = params.find<size_t>("processorNum");
+    if (processorNum == 0 || processorNum > MAX_BUS_AGENTS) {
+        out->fatal(CALL_INFO, -1, "Error! %s supports 1 to %zu processors, got %zu\n", getName().c_str(), MAX_BUS_AGENTS, processorNum);
+    }
+    topology = params.find<size_t>("topology", 0) == 1 ? NocTopology_t::MESH : NocTopology_t::RING;
+    meshX = params.find<size_t>("meshX", 0);
+    meshY = params.find<size_t>("meshY", 0);
+    if (topology == NocTopology_t::MESH) {
+        if (meshX == 0)
+            meshX = (size_t) ceil(sqrt((double) processorNum));
+        if (meshY == 0)
+            meshY = (processorNum + meshX - 1) / meshX;
+        nrouters = meshX * meshY;
+        if (nrouters < processorNum)
+            out->fatal(CALL_INFO, -1, "Error! %s mesh %zux%zu is too small for %zu processors\n", getName().c_str(), meshX, meshY, processorNum);
+    } else {
+        nrouters = processorNum;
+    }
+    memoryNode = params.find<size_t>("memoryNode", 0);
+    if (memoryNode >= nrouters)
+        out->fatal(CALL_INFO, -1, "Error! %s memoryNode %zu is not a router\n", getName().c_str(), memoryNode);
+
+    routerLatency = params.find<SimTime_t>("routerLatency", 2);
+    linkLatency = params.find<SimTime_t>("linkLatency", 1);
+    linkBandwidth = params.find<size_t>("linkBandwidth", 1);
+    size_t flitSize = params.find<size_t>("flitSize", 16);
+    blockSize = params.find<size_t>("blockSize", 64);
+    numVCs = params.find<size_t>("numVCs", 2);
+    vcBufferDepth = params.find<size_t>("vcBufferDepth", 8);
+    hotspotTopN = params.find<size_t>("hotspotTopN", 5);
+    configId = params.find<size_t>("configId", 0);
+    checker = params.find<bool>("checkCoherence", false) ? new CoherenceChecker(out, getName()) : nullptr;
+
+    // a header flit, plus the cache block for packets carrying data
+    controlFlits = 1;
+    dataFlits = 1 + (blockSize + flitSize - 1) / flitSize;
+    if (linkBandwidth == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs a non-zero linkBandwidth\n", getName().c_str());
+    if (vcBufferDepth < dataFlits)
+        out->fatal(CALL_INFO, -1, "Error! %s vcBufferDepth %zu cannot hold a %zu flit data packet\n", getName().c_str(), vcBufferDepth, dataFlits);
+    if (topology == NocTopology_t::RING && numVCs < 2)
+        out->fatal(CALL_INFO, -1, "Error! %s ring needs at least 2 virtual channels for its dateline\n", getName().c_str());
+    if (numVCs == 0)
+        out->fatal(CALL_INFO, -1, "Error! %s needs at least 1 virtual channel\n", getName().c_str());
+
+    // configure our link with a callback function that will be called whenever an event arrives
+    links.resize(processorNum);
+    for (size_t i = 0; i < processorNum; ++i) {
+        string portName = "nocPort_" + std::to_string(i);
+        links[i] = configureLink(portName, new Event::Handler<XTSimNoC>(this, &XTSimNoC::handleEvent));
+        sst_assert(links[i], CALL_INFO, -1, "Error in %s: Link configuration failed\n", getName().c_str());
+    }
+    memLink = configureLink("memPort", new Event::Handler<XTSimNoC>(this, &XTSimNoC::handleMemEvent));
+    nocTc = registerTimeBase(params.find<string>("nocClock", "1GHz"), false);
+    hopLink = configureSelfLink("hop", nocTc, new Event::Handler<XTSimNoC>(this, &XTSimNoC::handleHop));
+
+    buildTopology();
+}
+
+void XTSimNoC::buildTopology() {
+    ports = topology == NocTopology_t::RING ? 2 : 4;
+    nocLinks.resize(nrouters * ports);
+    for (size_t r = 0; r < nrouters; r++) {
+        for (size_t dir = 0; dir < ports; dir++) {
+            NocLink_t& link = nocLinks[r * ports + dir];
+            link.from = r;
+            link.to = NO_ROUTER;
+            link.dateline = false;
+            link.credits = vector<size_t>(numVCs, vcBufferDepth);
+            if (topology == NocTopology_t::RING) {
+                // 0 is clockwise, 1 counter-clockwise, the wrap-around links form the dateline
+                if (nrouters == 1)
+                    continue;
+                link.to = dir == 0 ? (r + 1) % nrouters : (r + nrouters - 1) % nrouters;
+                link.dateline = (dir == 0 && r == nrouters - 1) || (dir == 1 && r == 0);
+            } else {
+                // 0 east, 1 west, 2 north, 3 south
+                size_t x = r % meshX;
+                size_t y = r / meshX;
+                if (dir == 0 && x + 1 < meshX)
+                    link.to = r + 1;
+                else if (dir == 1 && x > 0)
+                    link.to = r - 1;
+                else if (dir == 2 && y + 1 < meshY)
+                    link.to = r + meshX;
+                else if (dir == 3 && y > 0)
+                    link.to = r - meshX;
+            }
+        }
+    }
+}
+
+size_t XTSimNoC::route(size_t cur, size_t dst) {
+    if (topology == NocTopology_t::RING) {
+        size_t cw = (dst + nrouters - cur) % nrouters;
+        size_t dir = cw <= nrouters - cw ? 0 : 1;
+        return cur * ports + dir;
+    }
+    // XY dimension order routing
+    size_t x = cur % meshX, y = cur / meshX;
+    size_t dx = dst % meshX, dy = dst / meshX;
+    size_t dir;
+    if (dx > x)
+        dir = 0;
+    else if (dx < x)
+        dir = 1;
+    else if (dy > y)
+        dir = 2;
+    else
+        dir = 3;
+    return cur * ports + dir;
+}
+
+int XTSimNoC::findVc(NocLink_t& link, NocPacket_t& pkt) {
+    size_t lo = 0, hi = numVCs;
+    if (topology == NocTopology_t::RING) {
+        // packets switch to the upper VC class once they cross the dateline, breaking the cyclic dependency
+        size_t half = numVCs / 2;
+        if (pkt.crossedDateline || link.dateline) {
+            lo = half;
+        } else {
+            hi = half;
+        }
+    }
+    for (size_t vc = lo; vc < hi; vc++) {
+        if (link.credits[vc] >= pkt.flits)
+            return vc;
+    }
+    return -1;
+}
+
+void XTSimNoC::inject(NocPacketType_t type, const CacheEvent& payload, size_t src, size_t dst, bool data) {
+    uint32_t id;
+    if (freePackets.empty()) {
+        packets.emplace_back();
+        id = packets.size() - 1;
+    } else {
+        id = freePackets.back();
+        freePackets.pop_back();
+    }
+    NocPacket_t& pkt = packets[id];
+    pkt.payload = payload;
+    pkt.type = type;
+    pkt.dst = dst;
+    pkt.cur = src;
+    pkt.flits = data ? dataFlits : controlFlits;
+    pkt.inLink = -1;
+    pkt.inVc = -1;
+    pkt.crossedDateline = false;
+    pkt.hops = 0;
+    pkt.injectTime = getCurrentSimTime(nocTc);
+    packetsByType[(int) type]++;
+    hopLink->send(routerLatency, new NocHopEvent(id));
+}
+
+// the packet finished the router pipeline at pkt.cur, eject it or move it to the next router
+void XTSimNoC::handleHop(SST::Event *ev) {
+    NocHopEvent *hop = dynamic_cast<NocHopEvent *>(ev);
+    uint32_t id = hop->packet;
+    delete hop;
+
+    if (packets[id].cur != packets[id].dst) {
+        size_t linkId = route(packets[id].cur, packets[id].dst);
+        if (!forward(id, linkId)) {
+            nocLinks[linkId].waiting.push_back(id);
+            nocLinks[linkId].blocked++;
+        }
+    } else {
+        // ejection buffers always accept, so the packet frees its slot right away
+        NocPacket_t pkt = packets[id];
+        freePackets.push_back(id);
+        packetsDelivered++;
+        totalHops += pkt.hops;
+        totalLatency += getCurrentSimTime(nocTc) - pkt.injectTime;
+        if (pkt.inLink >= 0)
+            releaseCredit(pkt.inLink, pkt.inVc, pkt.flits);
+        deliver(pkt);
+    }
+    drainRetries();
+}
+
+// credit-based flow control, the packet moves only if the downstream VC buffer has room for all its flits
+bool XTSimNoC::forward(uint32_t id, size_t linkId) {
+    NocLink_t& link = nocLinks[linkId];
+    NocPacket_t& pkt = packets[id];
+    int vc = findVc(link, pkt);
+    if (vc < 0)
+        return false;
+    link.credits[vc] -= pkt.flits;
+
+    SimTime_t now = getCurrentSimTime(nocTc);
+    SimTime_t start = std::max(now, link.freeAt);
+    SimTime_t serialization = (pkt.flits + linkBandwidth - 1) / linkBandwidth;
+    link.freeAt = start + serialization;
+    link.packets++;
+    link.flits += pkt.flits;
+    link.busyCycles += serialization;
+
+    int prevLink = pkt.inLink;
+    int prevVc = pkt.inVc;
+    if (link.dateline)
+        pkt.crossedDateline = true;
+    pkt.inLink = linkId;
+    pkt.inVc = vc;
+    pkt.cur = link.to;
+    pkt.hops++;
+    hopLink->send(start - now + serialization + linkLatency + routerLatency, new NocHopEvent(id));
+
+    // leaving this router frees its slot in the upstream buffer
+    if (prevLink >= 0)
+        releaseCredit(prevLink, prevVc, pkt.flits);
+    return true;
+}
+
+void XTSimNoC::releaseCredit(int linkId, int vc, size_t flits) {
+    nocLinks[linkId].credits[vc] += flits;
+    if (!nocLinks[linkId].waiting.empty())
+        retryLinks.push_back(linkId);
+}
+
+// retry blocked packets on links that got credits back, without recursing through forward()
+void XTSimNoC::drainRetries() {
+    while (!retryLinks.empty()) {
+        size_t linkId = retryLinks.front();
+        retryLinks.pop_front();
+        deque<uint32_t>& waiting = nocLinks[linkId].waiting;
+        for (auto it = waiting.begin(); it != waiting.end();) {
+            if (forward(*it, linkId)) {
+                it = waiting.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+void XTSimNoC::deliver(NocPacket_t& pkt) {
+    switch (pkt.type) {
+        case NocPacketType_t::SNOOP:
+            links[pkt.dst]->send(new SnoopEvent(slots[pkt.payload.busTag].snoop));
+            break;
+        case NocPacketType_t::SNOOP_RSP:
+            handleSnoopResponse(pkt.payload.pid, pkt.payload.event_type, pkt.payload.busTag);
+            break;
+        case NocPacketType_t::MEM_REQ:
+            memoryTraffic++;
+            memLink->send(new CacheEvent(pkt.payload));
+            break;
+        case NocPacketType_t::MEM_RSP: {
+            BusSlot_t& slot = slots[pkt.payload.busTag];
+            slot.memPending = false;
+            slot.responded = true;
+            slot.req.rsp = pkt.payload.rsp;
+            links[pkt.payload.pid]->send(new CacheEvent(pkt.payload));
+            retire(pkt.payload.busTag);
+            break;
+        }
+    }
+}
+
+void XTSimNoC::handleEvent(SST::Event *ev) {
+    SnoopRespEvent *token = dynamic_cast<SnoopRespEvent *>(ev);
+    if (token) {
+        // the snoop response travels back to the requester, carrying the block if this cache held it
+        BusSlot_t& slot = slots[token->busTag];
+        bool data = token->rsp != EVENT_TYPE::EMPTY && slot.req.event_type != EVENT_TYPE::BUS_UPGR;
+        CacheEvent payload;
+        payload.event_type = token->rsp;
+        payload.pid = token->pid;
+        payload.busTag = token->busTag;
+        inject(NocPacketType_t::SNOOP_RSP, payload, token->pid, slot.req.pid, data);
+        delete token;
+        return;
+    }
+    CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
+    if (cacheEvent->event_type == EVENT_TYPE::ROI_BEGIN) {
+        beginRoi(cacheEvent);
+        return;
+    }
+    if (cacheEvent->event_type == EVENT_TYPE::BUS_WB) {
+        if (checker)
+            checker->writeback(cacheEvent->addr / blockSize, cacheEvent->pid);
+        // posted write back, the block travels to the memory node
+        inject(NocPacketType_t::MEM_REQ, *cacheEvent, cacheEvent->pid, memoryNode, true);
+        delete cacheEvent;
+        return;
+    }
+    if (processorNum == 1) {
+        cacheEvent->src = DATA_SRC::MEMORY;
+        links[cacheEvent->pid]->send(cacheEvent);
+        return;
+    }
+
+    startTransaction(cacheEvent);
+    delete cacheEvent;
+}
+
+void XTSimNoC::handleMemEvent(SST::Event *ev) {
+    CacheEvent *cacheEvent = dynamic_cast<CacheEvent *>(ev);
+    memoryTraffic++;
+    inject(NocPacketType_t::MEM_RSP, *cacheEvent, memoryNode, cacheEvent->pid, true);
+    delete cacheEvent;
+}
+
+uint32_t XTSimNoC::allocSlot() {
+    if (freeSlots.empty()) {
+        slots.emplace_back();
+        return slots.size() - 1;
+    }
+    uint32_t tag = freeSlots.back();
+    freeSlots.pop_back();
+    return tag;
+}
+
+void XTSimNoC::startTransaction(CacheEvent *ev) {
+    uint32_t tag = allocSlot();
+    BusSlot_t& slot = slots[tag];
+    slot.req = *ev;
+    slot.req.busTag = tag;
+    slot.nresp = 0;
+    slot.sharedMask.reset();
+    slot.dirtyMask.reset();
+    slot.responded = false;
+    slot.memPending = false;
+    slot.arrival = getCurrentSimTime(nocTc);
+    slot.snoop = std::make_shared<const SnoopMsg_t>(SnoopMsg_t{slot.req.event_type, slot.req.addr, slot.req.pid,
+        slot.req.transactionId, slot.req.cacheLineIdx, tag, slot.req.pc, slot.req.size});
+
+    // snoops to different caches take different paths, so a transaction to a line another one
+    // is working on waits for it rather than racing its invalidations
+    LineQueue_t& queue = busyLines[slot.req.addr / blockSize];
+    if (queue.active == 0) {
+        queue.active = 1;
+        launch(tag);
+    } else {
+        queue.waiting.push_back(tag);
+        lineConflicts++;
+    }
+}
+
+void XTSimNoC::launch(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    if (checker)
+        checker->start(slot.req.addr / blockSize, slot.req.pid, slot.req.event_type);
+    // the broadcast is a unicast snoop packet to every other cache
+    for (size_t i = 0; i < processorNum; i++) {
+        if (i != (size_t) slot.req.pid)
+            inject(NocPacketType_t::SNOOP, slot.req, slot.req.pid, i, false);
+    }
+}
+
+void XTSimNoC::handleSnoopResponse(pid_t pid, EVENT_TYPE rsp, uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    slot.nresp++;
+    if (checker)
+        checker->snoopResponse(slot.req.addr / blockSize, pid, slot.req.pid, rsp);
+    if (rsp != EVENT_TYPE::EMPTY) {
+        slot.sharedMask.set(pid);
+        if (rsp == EVENT_TYPE::FLUSH)
+            slot.dirtyMask.set(pid);
+        // a read may take the first copy, a write waits until the snoops to farther caches invalidated theirs
+        if (!slot.responded && slot.req.event_type == EVENT_TYPE::BUS_RD)
+            respond(slot, EVENT_TYPE::SHARED, DATA_SRC::CACHE);
+    }
+    if (slot.nresp != processorNum - 1)
+        return;
+
+    if (!slot.responded) {
+        if (slot.req.event_type == EVENT_TYPE::BUS_UPGR || slot.sharedMask.any()) {
+            respond(slot, EVENT_TYPE::SHARED, DATA_SRC::CACHE);
+        } else {
+            // otherwise, read from memory
+            slot.memPending = true;
+            CacheEvent memReq = slot.req;
+            memReq.rsp = EVENT_TYPE::NOT_SHARED;
+            memReq.src = DATA_SRC::MEMORY;
+            inject(NocPacketType_t::MEM_REQ, memReq, memReq.pid, memoryNode, false);
+        }
+    }
+    if (!slots[tag].memPending)
+        retire(tag);
+}
+
+// every snoop was answered and the reply left for the requester, the line moves on to the next transaction
+void XTSimNoC::retire(uint32_t tag) {
+    BusSlot_t& slot = slots[tag];
+    size_t line = slot.req.addr / blockSize;
+    if (checker)
+        checker->complete(line, slot.req.pid, slot.req.event_type, slot.req.rsp);
+    freeSlots.push_back(tag);
+    releaseLine(line);
+}
+
+void XTSimNoC::releaseLine(size_t line) {
+    auto it = busyLines.find(line);
+    LineQueue_t& queue = it->second;
+    if (queue.waiting.empty()) {
+        busyLines.erase(it);
+        return;
+    }
+    uint32_t tag = queue.waiting.front();
+    queue.waiting.pop_front();
+    launch(tag);
+}
+
+// snoop responses are folded at the requester's router, so the reply is local
+void XTSimNoC::respond(BusSlot_t& slot, EVENT_TYPE rsp, DATA_SRC src) {
+    slot.req.rsp = rsp;
+    slot.req.src = src;
+    slot.responded = true;
+    links[slot.req.pid]->send(new CacheEvent(slot.req));
+}
+
+// the coherence checker keeps counting, a violation before the region of interest is still one
+void XTSimNoC::beginRoi(CacheEvent *ev) {
+    if (roiStarted) {
+        delete ev;
+        return;
+    }
+    roiStarted = true;
+    packetsDelivered = 0;
+    totalHops = 0;
+    totalLatency = 0;
+    for (size_t& count : packetsByType)
+        count = 0;
+    memoryTraffic = 0;
+    lineConflicts = 0;
+    for (NocLink_t& link : nocLinks) {
+        link.packets = 0;
+        link.flits = 0;
+        link.busyCycles = 0;
+        link.blocked = 0;
+    }
+    roiCycle = getCurrentSimTime(nocTc);
+    memLink->send(ev);
+}
+
+void XTSimNoC::finish() {
+    elapsedCycles = getCurrentSimTime(nocTc) - roiCycle;
+}
+
+/*
+ * Destructor, clean up our output
+ */
+XTSimNoC::~XTSimNoC() {
+    const char* topoName = topology == NocTopology_t::RING ? "ring" : "mesh";
+    printf("[noc-stat]: config%zu topology:%s routers:%zu packets:%zu snoop:%zu snoopRsp:%zu memReq:%zu memRsp:%zu memoryTraffic:%zu\n",
+        configId, topoName, nrouters, packetsDelivered, packetsByType[0], packetsByType[1], packetsByType[2], packetsByType[3], memoryTraffic);
+    printf("[noc-stat]: config%zu mean packet latency:%f cycles mean hops:%f\n", configId,
+        packetsDelivered ? (double) totalLatency / packetsDelivered : 0.0,
+        packetsDelivered ? (double) totalHops / packetsDelivered : 0.0);
+    printf("[noc-stat]: config%zu line conflicts:%zu\n", configId, lineConflicts);
+    if (checker) {
+        printf("[noc-stat]: config%zu coherence checked %zu snoop responses, no violations\n", configId, checker->checks());
+        delete checker;
+    }
+
+    vector<size_t> used;
+    SimTime_t busy = 0;
+    for (size_t i = 0; i < nocLinks.size(); i++) {
+        if (nocLinks[i].to != NO_ROUTER) {
+            used.push_back(i);
+            busy += nocLinks[i].busyCycles;
+        }
+    }
+    double meanUtil = elapsedCycles && !used.empty() ? (double) busy / used.size() / elapsedCycles * 100.0 : 0.0;
+    printf("[noc-stat]: config%zu links:%zu mean link utilization:%f%%\n", configId, used.size(), meanUtil);
+
+    // hotspots are the links with the most busy cycles
+    size_t n = std::min(hotspotTopN, used.size());
+    std::partial_sort(used.begin(), used.begin() + n, used.end(), [this](size_t a, size_t b) {
+        return nocLinks[a].busyCycles > nocLinks[b].busyCycles;
+    });
+    for (size_t i = 0; i < n; i++) {
+        NocLink_t& link = nocLinks[used[i]];
+        double util = elapsedCycles ? (double) link.busyCycles / elapsedCycles * 100.0 : 0.0;
+        printf("[noc-stat]: config%zu hotspot link %zu->%zu utilization:%f%% packets:%zu flits:%zu blocked:%zu\n",
+            configId, link.from, link.to, util, link.packets, link.flits, link.blocked);
+    }
+    delete out;
+}
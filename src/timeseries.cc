@@ -0,0 +1,84 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include "./include/timeseries.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+void TimeSeries::open(SST::Output* out, const std::string& prefix, const std::string& name, const std::vector<Column_t>& columns) {
+    std::string path = prefix + name + ".csv";
+    file = fopen(path.c_str(), "w");
+    if (!file) {
+        out->fatal(CALL_INFO, -1, "Error! %s cannot create time series file %s\n", name.c_str(), path.c_str());
+    }
+    this->columns = columns;
+    last.assign(columns.size(), 0);
+    opened = std::chrono::steady_clock::now();
+
+    fprintf(file, "simNs,wallSeconds");
+    for (const Column_t& column : columns) {
+        if (column.kind == RATE) {
+            fprintf(file, ",%s,%sPerSimSecond,%sPerWallSecond", column.name.c_str(), column.name.c_str(), column.name.c_str());
+        } else {
+            fprintf(file, ",%s", column.name.c_str());
+        }
+    }
+    fprintf(file, "\n");
+}
+
+void TimeSeries::close() {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+double TimeSeries::wallSeconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - opened).count();
+}
+
+void TimeSeries::sample(SimTime_t now, const std::vector<uint64_t>& values) {
+    if (!file)
+        return;
+    double wall = wallSeconds();
+    double simInterval = (now - lastNs) * 1e-9;
+    double wallInterval = wall - lastWall;
+
+    fprintf(file, "%lu,%.3f", now, wall);
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (columns[i].kind == LEVEL) {
+            fprintf(file, ",%lu", values[i]);
+            continue;
+        }
+        uint64_t delta = values[i] - last[i];
+        last[i] = values[i];
+        fprintf(file, ",%lu", delta);
+        if (columns[i].kind == RATE) {
+            fprintf(file, ",%.1f,%.1f", simInterval > 0 ? delta / simInterval : 0.0,
+                wallInterval > 0 ? delta / wallInterval : 0.0);
+        }
+    }
+    fprintf(file, "\n");
+    // a stuck run is usually killed, keep what was sampled so far readable
+    fflush(file);
+
+    lastNs = now;
+    lastWall = wall;
+}
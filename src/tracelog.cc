@@ -0,0 +1,168 @@
+// Copyright 2009-2022 NTESS. Under the terms
+// of Contract DE-NA0003525 with NTESS, the U.S.
+// Government retains certain rights in this software.
+//
+// Copyright (c) 2009-2022, NTESS
+// All rights reserved.
+//
+// Portions are copyright of other developers:
+// See the file CONTRIBUTORS.TXT in the top level directory
+// of the distribution for more information.
+//
+// This file is part of the SST software package. For license
+// information, see the LICENSE file in the top level directory of the
+// distribution.
+
+// This include is ***REQUIRED***
+// for ALL SST implementation files
+#include "sst_config.h"
+
+#include <atomic>
+#include <sstream>
+#include "./include/tracelog.h"
+
+using namespace SST;
+using namespace SST::xtsim;
+
+// File header: magic, version, record size, component id, name length, name
+static const char TRACE_MAGIC[8] = {'X', 'T', 'S', 'I', 'M', 'T', 'L', '1'};
+static const uint32_t TRACE_VERSION = 1;
+
+static const char* traceKindNames[(int) TraceKind::NUM_KINDS] = {
+    "CPU_REQ", "STATE", "EVICT", "BUS_REQ", "SNOOP", "ARB_REQ", "ARB_GRANT",
+    "BUS_START", "BUS_WAIT", "BUS_MEM", "BUS_RETIRE", "MEM_ARRIVE", "MEM_ISSUE"
+};
+
+TraceWriter& TraceWriter::instance() {
+    static TraceWriter writer;
+    return writer;
+}
+
+TraceWriter::~TraceWriter() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_one();
+    if (thread.joinable())
+        thread.join();
+}
+
+void TraceWriter::submit(FILE* file, std::vector<TraceRecord_t>&& records, bool last) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!started) {
+            thread = std::thread(&TraceWriter::run, this);
+            started = true;
+        }
+        chunks.push_back({file, std::move(records), last});
+    }
+    ready.notify_one();
+}
+
+std::vector<TraceRecord_t> TraceWriter::spare(size_t capacity) {
+    std::vector<TraceRecord_t> records;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!free.empty()) {
+            records = std::move(free.back());
+            free.pop_back();
+        }
+    }
+    records.reserve(capacity);
+    return records;
+}
+
+void TraceWriter::run() {
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        ready.wait(guard, [this] { return stopping || !chunks.empty(); });
+        // stopping only ends the thread once every queued chunk is on disk
+        if (chunks.empty())
+            return;
+        Chunk_t chunk = std::move(chunks.front());
+        chunks.pop_front();
+        guard.unlock();
+
+        fwrite(chunk.records.data(), sizeof(TraceRecord_t), chunk.records.size(), chunk.file);
+        if (chunk.last)
+            fclose(chunk.file);
+        chunk.records.clear();
+
+        guard.lock();
+        free.push_back(std::move(chunk.records));
+    }
+}
+
+void TraceLog::open(SST::Params& params, SST::Output* out, const std::string& name) {
+    if (!params.find<bool>("traceEnable", false))
+        return;
+    if (!XTSIM_TRACE_COMPILED) {
+        out->output("%s: traceEnable ignored, the records are only compiled in with -DXTSIM_TRACE\n", name.c_str());
+        return;
+    }
+    static std::atomic<uint16_t> nextId(0);
+    id = nextId++;
+
+    // runtime filters, only records inside the time window, address range and kinds are kept
+    startNs = params.find<SimTime_t>("traceStart", 0);
+    SimTime_t stop = params.find<SimTime_t>("traceStop", 0);
+    if (stop)
+        stopNs = stop;
+    addrLow = std::stoull(params.find<std::string>("traceAddrLow", "0"), nullptr, 0);
+    std::string high = params.find<std::string>("traceAddrHigh", "0");
+    if (std::stoull(high, nullptr, 0))
+        addrHigh = std::stoull(high, nullptr, 0);
+    std::string kindList = params.find<std::string>("traceKinds", "all");
+    if (kindList != "all") {
+        kinds = 0;
+        std::stringstream ss(kindList);
+        std::string kind;
+        while (getline(ss, kind, ',')) {
+            int k = 0;
+            while (k < (int) TraceKind::NUM_KINDS && kind != traceKindNames[k])
+                k++;
+            if (k == (int) TraceKind::NUM_KINDS) {
+                out->fatal(CALL_INFO, -1, "Error! %s unknown trace kind %s in traceKinds\n", name.c_str(), kind.c_str());
+            }
+            kinds |= 1u << k;
+        }
+    }
+
+    capacity = params.find<size_t>("traceBufferRecords", 8192);
+    if (capacity == 0) {
+        out->fatal(CALL_INFO, -1, "Error! %s needs a traceBufferRecords of at least 1\n", name.c_str());
+    }
+
+    std::string path = params.find<std::string>("tracePrefix", "") + name + ".xtl";
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        out->fatal(CALL_INFO, -1, "Error! %s cannot create trace file %s\n", name.c_str(), path.c_str());
+    }
+    uint16_t recordSize = sizeof(TraceRecord_t);
+    uint32_t nameLength = name.size();
+    fwrite(TRACE_MAGIC, 1, sizeof(TRACE_MAGIC), file);
+    fwrite(&TRACE_VERSION, sizeof(TRACE_VERSION), 1, file);
+    fwrite(&recordSize, sizeof(recordSize), 1, file);
+    fwrite(&id, sizeof(id), 1, file);
+    fwrite(&nameLength, sizeof(nameLength), 1, file);
+    fwrite(name.data(), 1, nameLength, file);
+
+    buffer = TraceWriter::instance().spare(capacity);
+    on = true;
+}
+
+void TraceLog::flush() {
+    TraceWriter& writer = TraceWriter::instance();
+    writer.submit(file, std::move(buffer), false);
+    buffer = writer.spare(capacity);
+}
+
+void TraceLog::close() {
+    if (!file)
+        return;
+    TraceWriter::instance().submit(file, std::move(buffer), true);
+    buffer.clear();
+    file = nullptr;
+    on = false;
+}
@@ -0,0 +1,83 @@
+# Import the SST module
+import sst
+import os
+import sys
+import argparse
+
+print("current directory:" + os.getcwd())
+
+# Coherence regression under concurrent bus transactions. Four caches share
+# lines of the no-padding trace (false sharing), keep several misses in flight
+# and the bus grants up to four transactions at once, so BUS_RD, BUS_RDX and
+# BUS_UPGR to one line race on the bus. With checkCoherence the bus checks
+# every snoop response against the bus order and stops with a fatal error on
+# a single-writer/multiple-reader violation. A clean run ends with
+#   [interconnect-stat]: config0 coherence checked N snoop responses, no violations
+#
+#   sst tests/busRaces.py --model-options="--protocol 0 --busModel 0"
+parser = argparse.ArgumentParser()
+parser.add_argument("--processors", type=int, default=4)
+parser.add_argument("--trace", default="no-padding_")
+parser.add_argument("--protocol", type=int, default=1)
+parser.add_argument("--busModel", type=int, default=1)
+parser.add_argument("--maxBusTransactions", type=int, default=4)
+parser.add_argument("--maxOutstandingReq", type=int, default=4)
+args = parser.parse_args(sys.argv[1:])
+
+num_processors = args.processors
+
+bus = sst.Component("bus", "xtsim.XTSimBus")
+bus.addParams({
+        "processorNum" : num_processors,
+        "busModel" : args.busModel,
+        "pipelineDepth" : 4,
+        "blockSize" : 64,
+        "checkCoherence" : 1
+})
+
+arbiter = sst.Component("arbiter", "xtsim.XTSimArbiter")
+arbiter.addParams({
+        "processorNum" : num_processors,
+        "arbPolicy" : 1,
+        "maxBusTransactions" : args.maxBusTransactions
+})
+
+memory = sst.Component("memory", "xtsim.XTSimMemory")
+memory.addParams({
+        "blockSize" : 64
+})
+memlink = sst.Link("memLink")
+memlink.connect( (bus, "memPort", "100ns"), (memory, "port", "100ns"))
+
+for i in range(num_processors):
+        cache = sst.Component("cache" + str(i), "xtsim.cache")
+        generator = sst.Component("generator" + str(i), "xtsim.XTSimGenerator")
+
+        generator.addParams({
+                "generatorID" : i,
+                "traceFilePath" : "./traces/" + args.trace + str(i) + ".txt",
+                "maxOutstandingReq" : args.maxOutstandingReq
+        })
+        # a small cache also evicts and writes back lines while they are contended
+        cache.addParams({
+                "blockSize" : 64,
+                "cacheSize" : 4096,
+                "associativity" : 2,
+                "cacheId" : i,
+                "replacementPolicy": 1,
+                "protocol" : args.protocol,
+                "writebackDirty" : 1
+        })
+
+        proclink = sst.Link(f"proc_link{i}")
+        proclink.connect( (cache, "processorPort", "1ns"), (generator, "processorPort", "1ns"))
+
+        buslink = sst.Link(f"bus_link{i}")
+        buslink.connect( (cache, "busPort", "1ns"), (bus, "busPort_" + str(i), "1ns"))
+
+        arblink = sst.Link(f"arb_link{i}")
+        arblink.connect( (cache, "arbiterPort", "1ns"), (arbiter, "arbiterPort_" + str(i), "1ns"))
+
+sst.setStatisticLoadLevel(7)
+sst.setStatisticOutput("sst.statOutputConsole")
+sst.enableAllStatisticsForComponentType("xtsim.cache")
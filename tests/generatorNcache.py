@@ -1,37 +1,184 @@
 # Import the SST module
 import sst
 import os
+import sys
+import argparse
 
 print("current directory:" + os.getcwd())
 
-num_processors = 4
-trace_name = "random_"
+# Every knob can be overridden with --model-options, e.g.
+#   sst tests/generatorNcache.py --model-options="--cacheSize 32768 --trace ocean_"
+parser = argparse.ArgumentParser()
+parser.add_argument("--processors", type=int, default=4)
+parser.add_argument("--trace", default="random_")
+parser.add_argument("--cacheSize", type=int, default=65536)
+parser.add_argument("--associativity", type=int, default=8)
+parser.add_argument("--blockSize", type=int, default=64)
+parser.add_argument("--protocol", type=int, default=1)
+parser.add_argument("--replacementPolicy", type=int, default=1)
+parser.add_argument("--arbPolicy", type=int, default=0)
+parser.add_argument("--maxBusTransactions", type=int, default=1)
+parser.add_argument("--maxOutstandingReq", type=int, default=1)
+parser.add_argument("--writebackDirty", type=int, default=0)
+parser.add_argument("--pagePolicy", type=int, default=0)
+parser.add_argument("--memChannels", type=int, default=1)
+parser.add_argument("--interleave", type=int, default=0)
+parser.add_argument("--numaNodes", type=int, default=0)
+parser.add_argument("--integratedArbiter", type=int, default=0)
+parser.add_argument("--interconnect", default="bus", choices=["bus", "ring", "mesh"])
+# single-writer/multiple-reader check on every snoop response of the bus or NoC
+parser.add_argument("--checkCoherence", type=int, default=0)
+parser.add_argument("--statOutput", default="console", choices=["console", "csv", "json"])
+# e.g. --sampleInterval 10us writes <timeSeriesPrefix><component>.csv for every component
+parser.add_argument("--sampleInterval", default="0")
+parser.add_argument("--timeSeriesPrefix", default="")
+parser.add_argument("--reportProgress", type=int, default=0)
+parser.add_argument("--watchdogInterval", default="100us")
+parser.add_argument("--watchdogFatal", type=int, default=0)
+# binary transaction logs, only written by a build with -DXTSIM_TRACE, see tools/decode_tracelog.py
+parser.add_argument("--traceLog", type=int, default=0)
+parser.add_argument("--tracePrefix", default="")
+parser.add_argument("--traceKinds", default="all")
+# warm state checkpoints, e.g. warm up once with
+#   --warmupAccesses 100000 --checkpointOut /tmp/warm_
+# then branch any number of runs from it with --checkpointIn /tmp/warm_
+parser.add_argument("--warmupAccesses", type=int, default=0)
+parser.add_argument("--checkpointOut", default="")
+parser.add_argument("--checkpointIn", default="")
+# region of interest of traces with #roi markers: 1 simulates only the ROI, 2 warms up on the accesses before it
+parser.add_argument("--roiMode", type=int, default=0)
+# a shared LLC slice in front of every memory channel, --llcSize 0 leaves it out
+# e.g. --llcPartition 1 --llcWayMasks 0x00ff,0x0f00,0x3000,0xc000 or --llcPartition 2 for utility-based quotas
+parser.add_argument("--llcSize", type=int, default=0)
+parser.add_argument("--llcAssociativity", type=int, default=16)
+parser.add_argument("--llcPartition", type=int, default=0)
+parser.add_argument("--llcWayMasks", default="")
+parser.add_argument("--llcRepartitionPeriod", default="10us")
+# per PC/page/line hotspot reports of every cache
+parser.add_argument("--profileHotspots", type=int, default=0)
+parser.add_argument("--hotspotTopN", type=int, default=10)
+args = parser.parse_args(sys.argv[1:])
+
+num_processors = args.processors
+trace_name = args.trace
 
 ### Create the components
 
-bus = sst.Component("bus", "xtsim.XTSimBus")
-arbiter = sst.Component("arbiter", "xtsim.XTSimArbiter")
-memory = sst.Component("memory", "xtsim.XTSimMemory")
+if args.interconnect == "bus":
+        bus = sst.Component("bus", "xtsim.XTSimBus")
+        busPortName = "busPort_"
+else:
+        bus = sst.Component("noc", "xtsim.XTSimNoC")
+        busPortName = "nocPort_"
+# with integrated arbitration the bus grants requests itself and there is no arbiter component
+integrated = args.integratedArbiter and args.interconnect == "bus"
+sampleParams = {
+        "sampleInterval" : args.sampleInterval,
+        "timeSeriesPrefix" : args.timeSeriesPrefix
+}
+# the generators write no transaction log
+traceParams = {
+        "traceEnable" : args.traceLog,
+        "tracePrefix" : args.tracePrefix,
+        "traceKinds" : args.traceKinds
+}
+# every component but the NoC saves and restores its warm state
+checkpointParams = {
+        "checkpointOut" : args.checkpointOut,
+        "checkpointIn" : args.checkpointIn
+}
+# with roiMode 2 the components with statistics hold them back until the region of interest starts
+roiParams = {
+        "roiMode" : args.roiMode
+}
 
 
 arbiterParams = {
         "processorNum" : num_processors,    # Required parameter, error if not provided
-        "arbPolicy" : 0, 
-        "maxBusTransactions" : 1
+        "arbPolicy" : args.arbPolicy, 
+        "maxBusTransactions" : args.maxBusTransactions
 }
-arbiter.addParams(arbiterParams)
+if not integrated:
+        arbiter = sst.Component("arbiter", "xtsim.XTSimArbiter")
+        arbiter.addParams(arbiterParams)
+        arbiter.addParams(sampleParams)
+        arbiter.addParams(roiParams)
+        arbiter.addParams(traceParams)
+        arbiter.addParams(checkpointParams)
 
-busParams = {
-        "processorNum" : num_processors,    # Required parameter, error if not provided
-        "memoryAccessTime" : 100 # unit: ns
-}
+if args.interconnect == "bus":
+        busParams = {
+                "processorNum" : num_processors,    # Required parameter, error if not provided
+                "memoryAccessTime" : 100, # unit: ns
+                "blockSize" : args.blockSize,
+                "memChannels" : args.memChannels,
+                "interleave" : args.interleave,
+                "numaNodes" : args.numaNodes,
+                "integratedArbiter" : int(integrated)
+        }
+        if integrated:
+                busParams.update(arbiterParams)
+else:
+        busParams = {
+                "processorNum" : num_processors,    # Required parameter, error if not provided
+                "topology" : 0 if args.interconnect == "ring" else 1,
+                "blockSize" : args.blockSize
+        }
+busParams["checkCoherence"] = args.checkCoherence
 bus.addParams(busParams)
+if args.interconnect == "bus":
+        bus.addParams(sampleParams)
+        bus.addParams(roiParams)
+        bus.addParams(traceParams)
+        bus.addParams(checkpointParams)
 
-memParams = {}
-memory.addParams(memParams)
-
-memlink = sst.Link("memLink")
-memlink.connect( (bus, "memPort", "100ns"), (memory, "port", "100ns"))
+# the NoC has a single memory node, only the bus spreads misses over channels
+num_channels = args.memChannels if args.interconnect == "bus" else 1
+memParams = {
+        "blockSize" : args.blockSize,
+        "pagePolicy" : args.pagePolicy,
+        "channels" : num_channels,
+        "interleaveSize" : 4096 if args.interleave == 1 else args.blockSize
+}
+llcParams = {
+        "processorNum" : num_processors,
+        "cacheSize" : args.llcSize,
+        "associativity" : args.llcAssociativity,
+        "blockSize" : args.blockSize,
+        "partitionMode" : args.llcPartition,
+        "wayMasks" : [int(mask, 0) for mask in args.llcWayMasks.split(",") if mask],
+        "repartitionPeriod" : args.llcRepartitionPeriod,
+        "channels" : num_channels,
+        "interleaveSize" : memParams["interleaveSize"]
+}
+memories = []
+memLinks = []
+llcs = []
+for c in range(num_channels):
+        suffix = "" if num_channels == 1 else str(c)
+        memory = sst.Component("memory" + suffix, "xtsim.XTSimMemory")
+        memory.addParams(memParams)
+        memory.addParams(sampleParams)
+        memory.addParams(roiParams)
+        memory.addParams(traceParams)
+        memory.addParams(checkpointParams)
+        memlink = sst.Link("memLink" + suffix)
+        memPortName = "memPort" if num_channels == 1 else "memPort_" + str(c)
+        if args.llcSize:
+                llc = sst.Component("llc" + suffix, "xtsim.XTSimLLC")
+                llc.addParams(llcParams)
+                llc.addParams(sampleParams)
+                llc.addParams(roiParams)
+                llc.addParams(checkpointParams)
+                llclink = sst.Link("llcLink" + suffix)
+                llclink.connect( (bus, memPortName, "10ns"), (llc, "busPort", "10ns"))
+                memlink.connect( (llc, "memPort", "100ns"), (memory, "port", "100ns"))
+                llcs.append(llc)
+                memLinks.append(llclink)
+        else:
+                memlink.connect( (bus, memPortName, "100ns"), (memory, "port", "100ns"))
+        memories.append(memory)
+        memLinks.append(memlink)
 
 ### Parameterize the components.
 # Run 'sst-info simpleElementExample.example0' at the command line 
@@ -50,44 +197,68 @@ for i in range(num_processors):
         generatorParams = {
                 "generatorID" : i,    # Required parameter, error if not provided
                 "traceFilePath" : "./traces/" + trace_name + str(i) + ".txt", 
-                "maxOutstandingReq" : 1
+                "maxOutstandingReq" : args.maxOutstandingReq,
+                "reportProgress" : args.reportProgress,
+                "watchdogInterval" : args.watchdogInterval,
+                "watchdogFatal" : args.watchdogFatal,
+                "warmupAccesses" : args.warmupAccesses,
+                "roiMode" : args.roiMode
         }
         generator.addParams(generatorParams)
+        generator.addParams(sampleParams)
+        generator.addParams(checkpointParams)
 
         cacheParams = {
-                "blockSize" : 64,    # Required parameter, error if not provided
-                "cacheSize" : 65536,       # Optional parameter, defaults to 16 if not provided,
-                "associativity" : 8,
+                "blockSize" : args.blockSize,    # Required parameter, error if not provided
+                "cacheSize" : args.cacheSize,       # Optional parameter, defaults to 16 if not provided,
+                "associativity" : args.associativity,
                 "cacheId" : i,
-                "replacementPolicy": 1,
-                "protocol" : 1
+                "replacementPolicy": args.replacementPolicy,
+                "protocol" : args.protocol,
+                "writebackDirty" : args.writebackDirty,
+                "integratedArbiter" : int(integrated),
+                "profileHotspots" : args.profileHotspots,
+                "hotspotTopN" : args.hotspotTopN
         }
         cache.addParams(cacheParams)
+        cache.addParams(sampleParams)
+        cache.addParams(roiParams)
+        cache.addParams(traceParams)
+        cache.addParams(checkpointParams)
 
         ### Link the components via their 'port' ports
         proclink = sst.Link(f"proc_link{i}")
         proclink.connect( (cache, "processorPort", "1ns"), (generator, "processorPort", "1ns"))
 
         buslink = sst.Link(f"bus_link{i}")
-        buslink.connect( (cache, "busPort", "1ns"), (bus, "busPort_" + str(i), "1ns"))
+        buslink.connect( (cache, "busPort", "1ns"), (bus, busPortName + str(i), "1ns"))
 
-        arblink = sst.Link(f"arb_link{i}")
-        arblink.connect( (cache, "arbiterPort", "1ns"), (arbiter, "arbiterPort_" + str(i), "1ns"))
+        if not integrated:
+                arblink = sst.Link(f"arb_link{i}")
+                arblink.connect( (cache, "arbiterPort", "1ns"), (arbiter, "arbiterPort_" + str(i), "1ns"))
+                arbLinks.append(arblink)
 
         procLinks.append(proclink)
         busLinks.append(buslink)
-        arbLinks.append(arblink)
 
 ### Enable statistics
 # Limit the verbosity of statistics to any with a load level from 0-7
 sst.setStatisticLoadLevel(7)
 
 # Determine where statistics should be sent
-sst.setStatisticOutput("sst.statOutputConsole") 
+if args.statOutput == "csv":
+        sst.setStatisticOutput("sst.statOutputCSV", {"filepath" : "./xtsim_stats.csv"})
+elif args.statOutput == "json":
+        sst.setStatisticOutput("sst.statOutputJSON", {"filepath" : "./xtsim_stats.json"})
+else:
+        sst.setStatisticOutput("sst.statOutputConsole")
 
-# Enable statistics on both components
+# Enable statistics on all components
 sst.enableAllStatisticsForComponentType("xtsim.XTSimGenerator")
 sst.enableAllStatisticsForComponentType("xtsim.XTSimBus")
+sst.enableAllStatisticsForComponentType("xtsim.XTSimArbiter")
+sst.enableAllStatisticsForComponentType("xtsim.XTSimMemory")
+sst.enableAllStatisticsForComponentType("xtsim.XTSimLLC")
 sst.enableAllStatisticsForComponentType("xtsim.cache")
 
 # Because the link latency is ~1ns and the components send one event
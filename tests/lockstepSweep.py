@@ -0,0 +1,99 @@
+# Import the SST module
+import sst
+import os
+
+print("current directory:" + os.getcwd())
+
+# One generator per core parses the trace once and feeds the same access
+# stream to every configuration below. Configuration 0 hangs off
+# processorPort, configuration k off shadowPort_(k-1). Each configuration
+# reports its own [cache-stat], [interconnect-stat] and [arbiter-stat] lines
+# tagged with its configId.
+#
+# Run with e.g. `sst -n 4 tests/lockstepSweep.py` to spread the
+# configurations over worker threads in batches.
+
+num_processors = 4
+trace_name = "random_"
+
+configs = [
+        {"cacheSize" : 16384, "associativity" : 4, "protocol" : 1},
+        {"cacheSize" : 32768, "associativity" : 4, "protocol" : 1},
+        {"cacheSize" : 65536, "associativity" : 8, "protocol" : 1},
+        {"cacheSize" : 65536, "associativity" : 8, "protocol" : 0},
+]
+
+options = sst.getProgramOptions()
+num_threads = int(options.get("num_threads", options.get("num-threads", 1)))
+if num_threads > 1:
+        # place every configuration on its own thread, batched round-robin
+        sst.setProgramOption("partitioner", "sst.self")
+
+def place(component, config_id):
+        if num_threads > 1:
+                component.setRank(0, config_id % num_threads)
+
+### Create the generators shared by all configurations
+generators = []
+for i in range(num_processors):
+        generator = sst.Component("generator" + str(i), "xtsim.XTSimGenerator")
+        generator.addParams({
+                "generatorID" : i,
+                "traceFilePath" : "./traces/" + trace_name + str(i) + ".txt",
+                "maxOutstandingReq" : 1,
+                "numShadows" : len(configs) - 1
+        })
+        place(generator, 0)
+        generators.append(generator)
+
+### Create one cache/bus/arbiter/memory system per configuration
+for c, config in enumerate(configs):
+        bus = sst.Component(f"bus_c{c}", "xtsim.XTSimBus")
+        arbiter = sst.Component(f"arbiter_c{c}", "xtsim.XTSimArbiter")
+        memory = sst.Component(f"memory_c{c}", "xtsim.XTSimMemory")
+        for comp in (bus, arbiter, memory):
+                place(comp, c)
+
+        arbiter.addParams({
+                "processorNum" : num_processors,
+                "arbPolicy" : 0,
+                "maxBusTransactions" : 1,
+                "configId" : c
+        })
+        bus.addParams({
+                "processorNum" : num_processors,
+                "memoryAccessTime" : 100, # unit: ns
+                "configId" : c
+        })
+
+        memlink = sst.Link(f"memLink_c{c}")
+        memlink.connect( (bus, "memPort", "100ns"), (memory, "port", "100ns"))
+
+        for i in range(num_processors):
+                cache = sst.Component(f"cache{i}_c{c}", "xtsim.cache")
+                place(cache, c)
+                cache.addParams({
+                        "blockSize" : 64,
+                        "cacheSize" : config["cacheSize"],
+                        "associativity" : config["associativity"],
+                        "cacheId" : i,
+                        "replacementPolicy": 1,
+                        "protocol" : config["protocol"],
+                        "configId" : c
+                })
+
+                genPort = "processorPort" if c == 0 else "shadowPort_" + str(c - 1)
+                proclink = sst.Link(f"proc_link{i}_c{c}")
+                proclink.connect( (cache, "processorPort", "1ns"), (generators[i], genPort, "1ns"))
+
+                buslink = sst.Link(f"bus_link{i}_c{c}")
+                buslink.connect( (cache, "busPort", "1ns"), (bus, "busPort_" + str(i), "1ns"))
+
+                arblink = sst.Link(f"arb_link{i}_c{c}")
+                arblink.connect( (cache, "arbiterPort", "1ns"), (arbiter, "arbiterPort_" + str(i), "1ns"))
+
+### Enable statistics
+sst.setStatisticLoadLevel(7)
+sst.setStatisticOutput("sst.statOutputConsole")
+sst.enableAllStatisticsForComponentType("xtsim.XTSimGenerator")
+sst.enableAllStatisticsForComponentType("xtsim.cache")
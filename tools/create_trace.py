@@ -27,6 +27,11 @@ trace_file.close()
 
 for line in trace:
     # print(line)
+    # region of interest markers belong to every thread
+    if line.startswith("#roi"):
+        for f in trace_files:
+            f.write(f"{line}\n")
+        continue
     for i in range(1, num_threads + 1):
         if reexp[i-1].match(line):
             trace_files[i-1].write(f"{line}\n")
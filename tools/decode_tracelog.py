@@ -0,0 +1,161 @@
+#!/bin/python3
+# Decoder of the binary transaction logs written with traceEnable.
+#
+# Every traced component writes <tracePrefix><name>.xtl, a small header
+# (magic, version, record size, component id, name) followed by fixed-size
+# records in simulated time order. The logs of all components are merged into
+# one timeline, optionally narrowed to a transaction, a line or a time window,
+# and printed as text or CSV. --summary prints record counts per component and
+# kind plus the bus residency of every transaction instead.
+#
+# The simulator only writes the logs when built with -DXTSIM_TRACE, e.g.
+#   sst tests/generatorNcache.py --model-options="--traceLog 1 --tracePrefix /tmp/run_"
+#   python3 tools/decode_tracelog.py /tmp/run_*.xtl --line 0x7f36bc872ec0
+import argparse
+import csv
+import heapq
+import struct
+import sys
+
+MAGIC = b"XTSIMTL1"
+RECORD = struct.Struct("<QQQHBBBBH")
+
+KINDS = ["CPU_REQ", "STATE", "EVICT", "BUS_REQ", "SNOOP", "ARB_REQ", "ARB_GRANT",
+         "BUS_START", "BUS_WAIT", "BUS_MEM", "BUS_RETIRE", "MEM_ARRIVE", "MEM_ISSUE"]
+EVENTS = ["PR_RD", "PR_WR", "BUS_RD", "BUS_RDX", "BUS_UPGR", "FLUSH", "SHARED", "NOT_SHARED", "EMPTY", "BUS_WB", "ROI_BEGIN"]
+STATES = ["M", "E", "S", "I"]
+ROW = ["row hit", "row miss", "row conflict"]
+
+parser = argparse.ArgumentParser()
+parser.add_argument("logs", nargs="+", help = "Transaction logs (.xtl) to merge")
+parser.add_argument("--txn", help = "Only records of this transaction id", default=None)
+parser.add_argument("--line", help = "Only records of the cache line holding this address", default=None)
+parser.add_argument("--block-size", help = "Cache block size in bytes, for --line", default=64)
+parser.add_argument("--start", help = "First simulated ns to print", default=0)
+parser.add_argument("--stop", help = "Simulated ns to stop at, 0 prints to the end", default=0)
+parser.add_argument("--kinds", help = "Comma-separated record kinds to print", default=None)
+parser.add_argument("--csv", help = "Write the timeline as CSV to this path instead of printing it", default=None)
+parser.add_argument("--summary", help = "Print counts and bus residency instead of the timeline", action="store_true")
+
+args = parser.parse_args()
+block_size = int(args.block_size)
+txn_filter = int(args.txn, 0) if args.txn is not None else None
+line_filter = int(args.line, 0) // block_size if args.line is not None else None
+start = int(args.start)
+stop = int(args.stop)
+kind_filter = None
+if args.kinds:
+    kind_filter = set()
+    for kind in args.kinds.split(","):
+        if kind not in KINDS:
+            sys.exit("unknown record kind " + kind)
+        kind_filter.add(KINDS.index(kind))
+
+
+def read_log(path):
+    """Header of one log and a generator over its records."""
+    f = open(path, "rb")
+    if f.read(8) != MAGIC:
+        sys.exit(path + " is not an xtsim transaction log")
+    version, record_size, component, name_length = struct.unpack("<IHHI", f.read(12))
+    if version != 1 or record_size != RECORD.size:
+        sys.exit("%s: unsupported log version %d with %d-byte records" % (path, version, record_size))
+    name = f.read(name_length).decode()
+
+    def records():
+        while True:
+            chunk = f.read(RECORD.size * 4096)
+            if not chunk:
+                break
+            for i in range(0, len(chunk) - RECORD.size + 1, RECORD.size):
+                yield RECORD.unpack_from(chunk, i)
+        f.close()
+    return component, name, records()
+
+
+def name_of(table, value):
+    return table[value] if value < len(table) else str(value)
+
+
+def details(kind, event, frm, to, aux):
+    """Human readable fields of one record, see TraceKind in include/tracelog.h."""
+    k = KINDS[kind] if kind < len(KINDS) else ""
+    if k == "CPU_REQ":
+        return "hit" if frm else "miss"
+    if k == "STATE":
+        return "%s -> %s" % (name_of(STATES, frm), name_of(STATES, to))
+    if k == "EVICT":
+        return "victim %s%s" % (name_of(STATES, frm), ", written back" if to else "")
+    if k == "SNOOP":
+        return "answered %s to cache%d" % (name_of(EVENTS, frm), aux)
+    if k in ("ARB_REQ", "ARB_GRANT"):
+        return "core%d" % aux
+    if k == "BUS_START":
+        return "tag %d%s" % (aux, ", joined a memory fill" if frm else "")
+    if k == "BUS_WAIT":
+        return "tag %d waits for its line" % aux
+    if k == "BUS_MEM":
+        return "channel %d%s" % (aux, ", remote" if frm else "")
+    if k == "BUS_RETIRE":
+        return "tag %d reply %s" % (aux, name_of(EVENTS, frm))
+    if k == "MEM_ISSUE":
+        return name_of(ROW, frm)
+    return ""
+
+
+logs = [read_log(path) for path in args.logs]
+names = {component: name for component, name, _ in logs}
+timeline = heapq.merge(*[records for _, _, records in logs], key=lambda r: r[0])
+
+
+def selected(record):
+    time, txn, addr, component, kind, event, frm, to, aux = record
+    if time < start or (stop and time >= stop):
+        return False
+    if txn_filter is not None and txn != txn_filter:
+        return False
+    if line_filter is not None and addr // block_size != line_filter:
+        return False
+    if kind_filter is not None and kind not in kind_filter:
+        return False
+    return True
+
+
+if args.summary:
+    counts = {}
+    bus_start = {}
+    residency = {}
+    for record in timeline:
+        if not selected(record):
+            continue
+        time, txn, addr, component, kind, event, frm, to, aux = record
+        key = (names.get(component, str(component)), name_of(KINDS, kind))
+        counts[key] = counts.get(key, 0) + 1
+        if kind == KINDS.index("BUS_START"):
+            bus_start[(component, aux)] = time
+        elif kind == KINDS.index("BUS_RETIRE") and (component, aux) in bus_start:
+            event_name = name_of(EVENTS, event)
+            total, n, worst = residency.get(event_name, (0, 0, 0))
+            elapsed = time - bus_start.pop((component, aux))
+            residency[event_name] = (total + elapsed, n + 1, max(worst, elapsed))
+    for (component, kind), count in sorted(counts.items()):
+        print("%-12s %-11s %d" % (component, kind, count))
+    for event_name, (total, n, worst) in sorted(residency.items()):
+        print("bus residency %-8s count: %d mean: %.2f ns max: %d ns" % (event_name, n, total / n, worst))
+    sys.exit(0)
+
+writer = None
+if args.csv:
+    out = open(args.csv, "w", newline="")
+    writer = csv.writer(out)
+    writer.writerow(["time", "component", "kind", "transaction", "addr", "event", "details"])
+for record in timeline:
+    if not selected(record):
+        continue
+    time, txn, addr, component, kind, event, frm, to, aux = record
+    row = [time, names.get(component, str(component)), name_of(KINDS, kind), txn, "%x" % addr,
+           name_of(EVENTS, event), details(kind, event, frm, to, aux)]
+    if writer:
+        writer.writerow(row)
+    else:
+        print("%10d ns %-12s %-11s txn %-18d %12s %-9s %s" % tuple(row))
@@ -13,25 +13,76 @@
 FILE *trace;
 PIN_LOCK pinlock;
 
-// Print a memory read record
-VOID RecordMemRead(THREADID threadId, VOID *ip, VOID *addr)
+// Region of interest markers. The traced program calls the two routines (or
+// runs the magic "xchg %rcx, %rcx" with rcx = 1 to begin and 2 to end) around
+// the code to be simulated, the trace gets a "#roi begin" / "#roi end" line
+// there for XTSimGenerator's roiMode.
+KNOB<std::string> KnobRoiBegin(KNOB_MODE_WRITEONCE, "pintool", "roi_begin", "xtsim_roi_begin", "routine whose call begins the region of interest");
+KNOB<std::string> KnobRoiEnd(KNOB_MODE_WRITEONCE, "pintool", "roi_end", "xtsim_roi_end", "routine whose call ends the region of interest");
+
+static const ADDRINT ROI_MAGIC_BEGIN = 1;
+static const ADDRINT ROI_MAGIC_END = 2;
+
+// Print a memory read record, the size in bytes follows the address
+VOID RecordMemRead(THREADID threadId, VOID *ip, VOID *addr, UINT32 size)
 {
 	PIN_GetLock(&pinlock, threadId + 1);
-	fprintf(trace, "threadId: %d, %p: R %p\n", threadId, ip, addr);
+	fprintf(trace, "threadId: %d, %p: R %p %u\n", threadId, ip, addr, size);
 	PIN_ReleaseLock(&pinlock);
 }
 
-// Print a memory write record
-VOID RecordMemWrite(THREADID threadId, VOID *ip, VOID *addr)
+// Print a memory write record, the size in bytes follows the address
+VOID RecordMemWrite(THREADID threadId, VOID *ip, VOID *addr, UINT32 size)
 {
 	PIN_GetLock(&pinlock, threadId + 1);
-	fprintf(trace, "threadId: %d, %p: W %p\n", threadId, ip, addr);
+	fprintf(trace, "threadId: %d, %p: W %p %u\n", threadId, ip, addr, size);
 	PIN_ReleaseLock(&pinlock);
 }
 
+// Print a region of interest marker, a line of its own outside any thread
+VOID RecordRoi(THREADID threadId, BOOL begin)
+{
+	PIN_GetLock(&pinlock, threadId + 1);
+	fprintf(trace, "#roi %s\n", begin ? "begin" : "end");
+	PIN_ReleaseLock(&pinlock);
+}
+
+VOID RecordRoiMagic(THREADID threadId, ADDRINT code)
+{
+	if (code == ROI_MAGIC_BEGIN || code == ROI_MAGIC_END)
+		RecordRoi(threadId, code == ROI_MAGIC_BEGIN);
+}
+
+// Is called for every image and hooks the region of interest routines it defines
+VOID Image(IMG img, VOID *v)
+{
+	RTN begin = RTN_FindByName(img, KnobRoiBegin.Value().c_str());
+	if (RTN_Valid(begin))
+	{
+		RTN_Open(begin);
+		RTN_InsertCall(begin, IPOINT_BEFORE, (AFUNPTR)RecordRoi, IARG_THREAD_ID, IARG_BOOL, TRUE, IARG_END);
+		RTN_Close(begin);
+	}
+	RTN end = RTN_FindByName(img, KnobRoiEnd.Value().c_str());
+	if (RTN_Valid(end))
+	{
+		RTN_Open(end);
+		RTN_InsertCall(end, IPOINT_BEFORE, (AFUNPTR)RecordRoi, IARG_THREAD_ID, IARG_BOOL, FALSE, IARG_END);
+		RTN_Close(end);
+	}
+}
+
 // Is called for every instruction and instruments reads and writes
 VOID Instruction(INS ins, VOID *v)
 {
+	// "xchg %rcx, %rcx" does nothing, the traced program uses it as the magic ROI marker
+	if (INS_IsXchg(ins) && INS_OperandIsReg(ins, 0) && INS_OperandIsReg(ins, 1) &&
+		INS_OperandReg(ins, 0) == REG_GCX && INS_OperandReg(ins, 1) == REG_GCX)
+	{
+		INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordRoiMagic, IARG_THREAD_ID, IARG_REG_VALUE, REG_GCX, IARG_END);
+		return;
+	}
+
 	// Instruments memory accesses using a predicated call, i.e.
 	// the instrumentation is called iff the instruction will actually be executed.
 	//
@@ -45,7 +96,7 @@ VOID Instruction(INS ins, VOID *v)
 		if (INS_MemoryOperandIsRead(ins, memOp))
 		{
 			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemRead, IARG_THREAD_ID, IARG_INST_PTR, IARG_MEMORYOP_EA, memOp,
-									 IARG_END);
+									 IARG_MEMORYOP_SIZE, memOp, IARG_END);
 		}
 		// Note that in some architectures a single memory operand can be
 		// both read and written (for instance incl (%eax) on IA-32)
@@ -53,7 +104,7 @@ VOID Instruction(INS ins, VOID *v)
 		if (INS_MemoryOperandIsWritten(ins, memOp))
 		{
 			INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)RecordMemWrite, IARG_THREAD_ID, IARG_INST_PTR, IARG_MEMORYOP_EA, memOp,
-									 IARG_END);
+									 IARG_MEMORYOP_SIZE, memOp, IARG_END);
 		}
 	}
 }
@@ -80,12 +131,15 @@ INT32 Usage()
 
 int main(int argc, char *argv[])
 {
+	// the ROI routines are looked up by name
+	PIN_InitSymbols();
 	if (PIN_Init(argc, argv))
 		return Usage();
 	PIN_InitLock(&pinlock);
 
 	trace = fopen("pinatrace.out", "w");
 
+	IMG_AddInstrumentFunction(Image, 0);
 	INS_AddInstrumentFunction(Instruction, 0);
 	PIN_AddFiniFunction(Fini, 0);
 
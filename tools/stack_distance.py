@@ -0,0 +1,191 @@
+#!/bin/python3
+# Single-pass LRU stack-distance profiler.
+#
+# Streams each core's trace once and builds per-set stack-distance histograms
+# for every power-of-two set count. Since LRU has the inclusion property, the
+# miss count of an (nsets, associativity) cache is the number of accesses whose
+# stack distance within their set is >= associativity, so one run gives the
+# miss ratio of every cacheSize/associativity pair the xtsim cache supports.
+#
+# Cross-core sharing distance is measured on a round-robin interleaving of the
+# per-core traces (the order the simulator sees with maxOutstandingReq = 1).
+import argparse
+import re
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--trace-prefix", help = "Prefix of per-core trace files, e.g. ./traces/ocean_", required=True)
+parser.add_argument("--num-threads", help = "Number of cores (trace files) to analyze", required=True)
+parser.add_argument("--block-size", help = "Cache block size in bytes", default=64)
+parser.add_argument("--min-sets", help = "Smallest set count to profile", default=1)
+parser.add_argument("--max-sets", help = "Largest set count to profile", default=4096)
+parser.add_argument("--max-assoc", help = "Largest associativity to report", default=16)
+parser.add_argument("--top", help = "Number of most shared lines to report", default=10)
+parser.add_argument("--csv", help = "Optional path to write the miss ratio table as CSV", default=None)
+
+args = parser.parse_args()
+trace_prefix = args.trace_prefix
+num_threads = int(args.num_threads)
+block_size = int(args.block_size)
+min_sets = int(args.min_sets)
+max_sets = int(args.max_sets)
+max_assoc = int(args.max_assoc)
+top_n = int(args.top)
+
+access_re = re.compile(r"threadId: \d+, \S+: ([RW]) (0x[0-9a-fA-F]+)")
+
+
+class Fenwick:
+    """Binary indexed tree over access slots, used as an order-statistic
+    structure: slot t holds 1 while it is the most recent access of its line.
+    Slots are appended in order, the tree doubles when it runs out of them."""
+
+    def __init__(self):
+        self.n = 0
+        self.tree = [0]
+        self.values = []
+
+    def append(self):
+        # a new slot holding 0, returns its index
+        slot = len(self.values)
+        self.values.append(0)
+        if slot >= self.n:
+            self.grow(max(1, 2 * self.n))
+        return slot
+
+    def grow(self, n):
+        # rebuild over the existing slots in O(n)
+        self.n = n
+        self.tree = [0] * (n + 1)
+        for i, v in enumerate(self.values):
+            j = i + 1
+            self.tree[j] += v
+            k = j + (j & (-j))
+            if k <= n:
+                self.tree[k] += self.tree[j]
+
+    def add(self, i, delta):
+        self.values[i] += delta
+        i += 1
+        while i <= self.n:
+            self.tree[i] += delta
+            i += i & (-i)
+
+    def prefix(self, i):
+        # sum of slots [0, i)
+        s = 0
+        while i > 0:
+            s += self.tree[i]
+            i -= i & (-i)
+        return s
+
+
+def read_lines(path):
+    lines = []
+    with open(path) as f:
+        for line in f:
+            m = access_re.match(line)
+            if m:
+                lines.append(int(m.group(2), 16) // block_size)
+    return lines
+
+
+class StackProfile:
+    """Per-set stack distances of one set count, fed one access at a time.
+    hist[d] is the number of accesses with per-set stack distance d, cold
+    (first-touch) accesses are counted under key None."""
+
+    def __init__(self, nsets):
+        self.nsets = nsets
+        self.trees = [Fenwick() for _ in range(nsets)]
+        self.last = {}
+        self.hist = {}
+
+    def access(self, line):
+        tree = self.trees[line % self.nsets]
+        t = tree.append()
+        prev = self.last.get(line)
+        if prev is None:
+            d = None
+        else:
+            # distinct lines of this set touched after the previous access
+            d = tree.prefix(t) - tree.prefix(prev + 1)
+            tree.add(prev, -1)
+        tree.add(t, 1)
+        self.last[line] = t
+        self.hist[d] = self.hist.get(d, 0) + 1
+
+
+def misses_for_assoc(hist, assoc):
+    return sum(n for d, n in hist.items() if d is None or d >= assoc)
+
+
+def sharing_distances(traces):
+    """Round-robin interleave the cores and, for every access to a line last
+    touched by another core, record the number of global accesses in between."""
+    owner = {}
+    transfers = {}
+    hist = {}
+    clock = 0
+    longest = max(len(t) for t in traces)
+    for i in range(longest):
+        for core, trace in enumerate(traces):
+            if i >= len(trace):
+                continue
+            line = trace[i]
+            prev = owner.get(line)
+            if prev is not None and prev[0] != core:
+                d = clock - prev[1]
+                bucket = d.bit_length()
+                hist[bucket] = hist.get(bucket, 0) + 1
+                count, total = transfers.get(line, (0, 0))
+                transfers[line] = (count + 1, total + d)
+            owner[line] = (core, clock)
+            clock += 1
+    return hist, transfers
+
+
+set_counts = []
+nsets = min_sets
+while nsets <= max_sets:
+    set_counts.append(nsets)
+    nsets *= 2
+assocs = []
+assoc = 1
+while assoc <= max_assoc:
+    assocs.append(assoc)
+    assoc *= 2
+
+traces = [read_lines(f"{trace_prefix}{i}.txt") for i in range(num_threads)]
+
+rows = []
+for core, lines in enumerate(traces):
+    # one pass over the accesses updates the stacks of every set count
+    profiles = [StackProfile(nsets) for nsets in set_counts]
+    for line in lines:
+        for profile in profiles:
+            profile.access(line)
+    for profile in profiles:
+        for assoc in assocs:
+            misses = misses_for_assoc(profile.hist, assoc)
+            rows.append((core, profile.nsets * assoc * block_size, profile.nsets, assoc, len(lines), misses))
+
+print("[stack-dist]: core cacheSize sets associativity accesses misses missRate")
+for core, size, nsets, assoc, accesses, misses in rows:
+    rate = misses / accesses * 100.0 if accesses else 0.0
+    print(f"[stack-dist]: {core} {size} {nsets} {assoc} {accesses} {misses} {rate:f}")
+
+if args.csv:
+    with open(args.csv, "w") as f:
+        f.write("core,cacheSize,sets,associativity,accesses,misses\n")
+        for row in rows:
+            f.write(",".join(str(v) for v in row) + "\n")
+
+hist, transfers = sharing_distances(traces)
+print("[sharing-dist]: log2 bucket histogram of cross-core reuse distance (accesses)")
+for bucket in sorted(hist):
+    lo = 0 if bucket == 0 else 1 << (bucket - 1)
+    print(f"[sharing-dist]: [{lo}, {1 << bucket}) {hist[bucket]}")
+print(f"[sharing-dist]: shared lines: {len(transfers)} transfers: {sum(c for c, _ in transfers.values())}")
+ranked = sorted(transfers.items(), key=lambda kv: kv[1][0], reverse=True)[:top_n]
+for line, (count, total) in ranked:
+    print(f"[sharing-dist]: line {line * block_size:#x} transfers: {count} mean distance: {total / count:.1f}")
@@ -0,0 +1,202 @@
+#!/bin/python3
+# Parallel design-space sweep driver.
+#
+# Expands a JSON parameter grid into configurations, runs each one through
+# tests/generatorNcache.py with `sst -n <threads>` while keeping the total
+# number of busy threads within the local core count, and collects the
+# [cache-stat]/[interconnect-stat]/[arbiter-stat] output into one CSV table.
+#
+# Results are cached under --cache-dir by a hash of the configuration, the
+# SST config script, the trace files it reads and the xtsim library build
+# (--library, or --build-id when the library cannot be located), so re-running
+# a sweep only simulates configurations that changed.
+#
+# Example grid file:
+#   {"cacheSize": [16384, 65536], "associativity": [4, 8], "protocol": [0, 1],
+#    "arbPolicy": [0, 1], "maxBusTransactions": [1], "trace": ["random_", "ocean_"]}
+import argparse
+import hashlib
+import itertools
+import json
+import os
+import re
+import subprocess
+import sys
+import threading
+from concurrent.futures import ThreadPoolExecutor
+
+parser = argparse.ArgumentParser()
+parser.add_argument("--grid", help = "JSON file mapping parameter names to lists of values", required=True)
+parser.add_argument("--out", help = "CSV file to write the results table to", default="sweep.csv")
+parser.add_argument("--cache-dir", help = "Directory holding cached per-configuration results", default=".sweep-cache")
+parser.add_argument("--config", help = "SST config script to run", default="tests/generatorNcache.py")
+parser.add_argument("--trace-dir", help = "Directory holding the per-core trace files", default="traces")
+parser.add_argument("--sst", help = "Path to the sst binary", default="sst")
+parser.add_argument("--threads", help = "Threads per simulation (sst -n)", default=1)
+parser.add_argument("--cores", help = "Core budget shared by all concurrent runs", default=os.cpu_count())
+parser.add_argument("--force", help = "Ignore cached results", action="store_true")
+parser.add_argument("--library", help = "Built libxtsim.so whose contents key the cache, found under .libs or the SST install when empty", default="")
+parser.add_argument("--build-id", help = "Extra string keying the cache, e.g. the git commit the library was built from", default="")
+
+args = parser.parse_args()
+threads = int(args.threads)
+cores = max(int(args.cores), threads)
+
+cache_stat_re = re.compile(r"\[cache-stat\]: config\d+ cache(\d+) hit rate: \S+ miss rate: \S+ "
+                           r"nhits: (\d+) nmisses: (\d+) nevictions: (\d+) ninvalidations: (\d+)")
+bus_stat_re = re.compile(r"\[interconnect-stat\]: config\d+ (totalTraffic|reqTraffic|respTraffic|memoryTraffic):(\d+)")
+arb_stat_re = re.compile(r"\[arbiter-stat\]: config\d+ final granting statistics:\s*\n\s*([\d ]+)")
+sim_time_re = re.compile(r"Simulation is complete, simulated time: ([\d.]+) (\w+)")
+
+
+def expand(grid):
+    keys = sorted(grid)
+    for values in itertools.product(*(grid[k] for k in keys)):
+        yield dict(zip(keys, values))
+
+
+def file_digest(path, h):
+    st = os.stat(path)
+    h.update(f"{path}:{st.st_size}:{st.st_mtime_ns}".encode())
+
+
+def find_library():
+    if args.library:
+        return args.library
+    candidates = [os.path.join(".libs", "libxtsim.so")]
+    try:
+        prefix = subprocess.run(["sst-config", "--prefix"], capture_output=True, text=True).stdout.strip()
+        if prefix:
+            candidates.append(os.path.join(prefix, "lib", "sst-elements-library", "libxtsim.so"))
+            candidates.append(os.path.join(prefix, "lib", "libxtsim.so"))
+    except OSError:
+        pass
+    for path in candidates:
+        if os.path.exists(path):
+            return path
+    return ""
+
+
+def library_digest():
+    # the contents, not the mtime, so a reinstall of the same build keeps the cache
+    h = hashlib.sha1(args.build_id.encode())
+    if library:
+        with open(library, "rb") as f:
+            for chunk in iter(lambda: f.read(1 << 20), b""):
+                h.update(chunk)
+    return h.hexdigest()
+
+
+def config_hash(config):
+    h = hashlib.sha1()
+    h.update(json.dumps(config, sort_keys=True).encode())
+    h.update(build_digest.encode())
+    file_digest(args.config, h)
+    trace = config.get("trace", "random_")
+    processors = int(config.get("processors", 4))
+    for i in range(processors):
+        path = os.path.join(args.trace_dir, f"{trace}{i}.txt")
+        if os.path.exists(path):
+            file_digest(path, h)
+    return h.hexdigest()
+
+
+library = find_library()
+if not library and not args.build_id:
+    print("warning: libxtsim.so not found, cached results are not invalidated by a rebuild; pass --library or --build-id",
+          file=sys.stderr)
+build_digest = library_digest()
+
+
+def parse(output):
+    result = {"nhits": 0, "nmisses": 0, "nevictions": 0, "ninvalidations": 0}
+    for m in cache_stat_re.finditer(output):
+        result["nhits"] += int(m.group(2))
+        result["nmisses"] += int(m.group(3))
+        result["nevictions"] += int(m.group(4))
+        result["ninvalidations"] += int(m.group(5))
+    accesses = result["nhits"] + result["nmisses"]
+    result["missRate"] = result["nmisses"] / accesses * 100.0 if accesses else 0.0
+    for m in bus_stat_re.finditer(output):
+        result[m.group(1)] = int(m.group(2))
+    m = arb_stat_re.search(output)
+    if m:
+        result["grants"] = " ".join(m.group(1).split())
+    m = sim_time_re.search(output)
+    if m:
+        result["simTime"] = f"{m.group(1)} {m.group(2)}"
+    return result
+
+
+class CoreBudget:
+    """Blocks a run until enough cores are free for its sst -n thread count."""
+
+    def __init__(self, total):
+        self.free = total
+        self.cond = threading.Condition()
+
+    def acquire(self, n):
+        with self.cond:
+            while self.free < n:
+                self.cond.wait()
+            self.free -= n
+
+    def release(self, n):
+        with self.cond:
+            self.free += n
+            self.cond.notify_all()
+
+
+def run(config, budget):
+    key = config_hash(config)
+    path = os.path.join(args.cache_dir, key + ".json")
+    if not args.force and os.path.exists(path):
+        with open(path) as f:
+            return config, json.load(f), True
+
+    model_options = " ".join(f"--{k} {v}" for k, v in sorted(config.items()))
+    cmd = [args.sst, "-n", str(threads), args.config, f"--model-options={model_options}"]
+    budget.acquire(threads)
+    try:
+        proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    finally:
+        budget.release(threads)
+    if proc.returncode != 0:
+        print(f"[sweep]: failed ({proc.returncode}): {' '.join(cmd)}", file=sys.stderr)
+        print(proc.stdout[-2000:], file=sys.stderr)
+        return config, None, False
+
+    result = parse(proc.stdout)
+    with open(path, "w") as f:
+        json.dump(result, f)
+    return config, result, False
+
+
+with open(args.grid) as f:
+    grid = json.load(f)
+configs = list(expand(grid))
+os.makedirs(args.cache_dir, exist_ok=True)
+
+budget = CoreBudget(cores)
+with ThreadPoolExecutor(max_workers=max(1, cores // threads)) as pool:
+    results = list(pool.map(lambda c: run(c, budget), configs))
+
+param_cols = sorted(grid)
+stat_cols = []
+for _, result, _ in results:
+    for k in (result or {}):
+        if k not in stat_cols:
+            stat_cols.append(k)
+
+cached = sum(1 for _, _, hit in results if hit)
+failed = sum(1 for _, result, _ in results if result is None)
+print(f"[sweep]: {len(configs)} configurations, {cached} cached, {len(configs) - cached - failed} simulated, {failed} failed")
+
+with open(args.out, "w") as f:
+    f.write(",".join(param_cols + stat_cols) + "\n")
+    for config, result, _ in results:
+        if result is None:
+            continue
+        row = [str(config[k]) for k in param_cols] + [str(result.get(k, "")) for k in stat_cols]
+        f.write(",".join(row) + "\n")
+print(f"[sweep]: results written to {args.out}")